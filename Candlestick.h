@@ -3,6 +3,15 @@
 #include <ostream>
 using namespace std;
 
+// optional per-period distribution, filled in when extended statistics are requested
+struct CandleStats {
+    bool available = false;
+    double stddev = 0.0;
+    double median = 0.0;
+    double p10 = 0.0;
+    double p90 = 0.0;
+};
+
 class Candlestick {
 public:
     Candlestick(double open, double high, double low, double close, string timestamp);
@@ -11,6 +20,8 @@ public:
     double low;
     double close;
     string timestamp;
+    CandleStats stats;
+    double coverage = 100.0; // % of the period's hours with a valid reading
     friend std::ostream& operator<<(std::ostream& os, Candlestick& candlestick);
 
 };
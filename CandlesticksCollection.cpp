@@ -1,9 +1,12 @@
 #include "CandlesticksCollection.h"
 #include "CsvReader.h"
+#include "RollingIndicators.h"
+#include "CyclicProfile.h"
 #include <vector>
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <cmath>
 using namespace std;
 
 CandlesticksCollection::CandlesticksCollection(
@@ -14,17 +17,50 @@ CandlesticksCollection::CandlesticksCollection(
     float minTemp,
     float maxTemp,
     string startDate,
-    string endDate
+    string endDate,
+    bool extendedStats,
+    int maxGapFill
 ) :
     filename{ filename },
     country{ country },
     timeframe{ timeframe },
+    year{ year },
     minTemp{ minTemp },
     maxTemp{ maxTemp },
     startDate{ startDate },
-    endDate{ endDate }
+    endDate{ endDate },
+    extendedStats{ extendedStats },
+    maxGapFill{ maxGapFill }
 {
-    candlesticks = CSVReader::computeCandlesticks(filename, country, timeframe, year, minTemp, maxTemp, startDate, endDate);
+    candlesticks = CSVReader::computeCandlesticks(filename, country, timeframe, year, minTemp, maxTemp, startDate, endDate,
+        extendedStats, maxGapFill);
+};
+
+CandlesticksCollection::CandlesticksCollection(
+    const DatasetSnapshot& snapshot,
+    string country,
+    Timeframe timeframe,
+    string year,
+    float minTemp,
+    float maxTemp,
+    string startDate,
+    string endDate,
+    bool extendedStats,
+    int maxGapFill
+) :
+    filename{ snapshot.path },
+    country{ country },
+    timeframe{ timeframe },
+    year{ year },
+    minTemp{ minTemp },
+    maxTemp{ maxTemp },
+    startDate{ startDate },
+    endDate{ endDate },
+    extendedStats{ extendedStats },
+    maxGapFill{ maxGapFill }
+{
+    candlesticks = snapshot.computeCandlesticks(country, timeframe, year, minTemp, maxTemp, startDate, endDate,
+        extendedStats, maxGapFill);
 };
 
 string CandlesticksCollection::timeframeToString(Timeframe tf) {
@@ -34,14 +70,62 @@ string CandlesticksCollection::timeframeToString(Timeframe tf) {
     }
 }
 
+CandlesticksCollection CandlesticksCollection::withCandlesticks(const vector<Candlestick>& derived) const {
+    CandlesticksCollection copy = *this;
+    copy.candlesticks = derived;
+    return copy;
+}
+
+void CandlesticksCollection::setIndicators(int window, double bandWidth) {
+    indicatorWindow = window;
+    this->bandWidth = bandWidth;
+}
+
 // show candlesticks data in table-like format
 void CandlesticksCollection::displayCandlesticks() {
     cout << CandlesticksCollection::timeframeToString(this->timeframe) << " candlesticks representation for " << this->country << " temperature:" << endl << endl;
-    cout << "Date\tOpen\tHigh\tLow\tClose" << endl << endl; //headers
+    cout << "Date\tOpen\tHigh\tLow\tClose";
+    if (extendedStats) cout << "\tStdDev\tP10\tMedian\tP90\tCoverage";
+    if (indicatorWindow > 0) cout << "\tSMA\tEMA\tUpper\tLower\tRollHi\tRollLo";
+    cout << endl << endl; //headers
     cout << fixed;
     cout.precision(3); //for conistency in output
-    for (Candlestick cs : candlesticks) {
-        cout << cs;
+    vector<IndicatorPoint> indicators;
+    if (indicatorWindow > 0) indicators = CandleIndicators::compute(candlesticks, indicatorWindow, bandWidth);
+    for (size_t i = 0; i < candlesticks.size(); i++) {
+        Candlestick& cs = candlesticks[i];
+        if (!cs.stats.available && indicators.empty()) {
+            cout << cs;
+            continue;
+        }
+        cout << cs.timestamp << "\t" << cs.open << "\t" << cs.high << "\t" << cs.low << "\t" << cs.close;
+        if (cs.stats.available) {
+            cout << "\t" << cs.stats.stddev << "\t" << cs.stats.p10 << "\t" << cs.stats.median << "\t" << cs.stats.p90 << "\t" << cs.coverage << "%";
+        }
+        else if (extendedStats) {
+            cout << "\t-\t-\t-\t-\t" << cs.coverage << "%";
+        }
+        if (!indicators.empty()) {
+            const IndicatorPoint& point = indicators[i];
+            if (point.ready) {
+                cout << "\t" << point.sma << "\t" << point.ema << "\t" << point.upperBand << "\t" << point.lowerBand
+                    << "\t" << point.rollingHigh << "\t" << point.rollingLow;
+            }
+            else {
+                cout << "\t-\t-\t-\t-\t-\t-"; // window not filled yet
+            }
+        }
+        cout << endl;
+    }
+}
+
+// share of each period's hours backed by a valid reading (interpolated readings not counted)
+void CandlesticksCollection::displayCoverage() {
+    cout << "Date\tCoverage" << endl << endl;
+    cout << fixed;
+    cout.precision(1);
+    for (const Candlestick& cs : candlesticks) {
+        cout << cs.timestamp << "\t" << cs.coverage << "%" << endl;
     }
 }
 
@@ -191,6 +275,38 @@ void CandlesticksCollection::plotCandlesticksOnGrid(PlotData& pd)
     }
 }
 
+// indicator markers over the candles: bands and rolling extremes across the body, averages at the center
+void CandlesticksCollection::plotIndicatorsOnGrid(PlotData& pd)
+{
+    int colsPerCandle = (timeframe == Timeframe::Yearly) ? 5 : 8;
+    int candleCenterOffset = (timeframe == Timeframe::Yearly) ? 2 : 3;
+    int candleBodyStart = (timeframe == Timeframe::Yearly) ? 1 : 2;
+    int candleBodyWidth = 3;
+
+    vector<IndicatorPoint> indicators = CandleIndicators::compute(candlesticks, indicatorWindow, bandWidth);
+    auto mark = [&](double temp, int col, const string& cell) {
+        int row = scaleTemp(temp, pd.minTemp, pd.degreesPerRow, pd.numRows);
+        if (row >= 0 && row < pd.bottomRow && col < pd.numCols) {
+            pd.grid[row][col] = cell;
+        }
+    };
+
+    for (int i = 0; i < (int)indicators.size(); i++) {
+        const IndicatorPoint& point = indicators[i];
+        if (!point.ready) continue;
+        int candleLeft = 1 + i * colsPerCandle;
+        for (int w = 0; w < candleBodyWidth; w++) {
+            int col = candleLeft + candleBodyStart + w;
+            mark(point.rollingHigh, col, "\033[34m=\033[0m");
+            mark(point.rollingLow, col, "\033[34m=\033[0m");
+            mark(point.upperBand, col, "\033[36m-\033[0m");
+            mark(point.lowerBand, col, "\033[36m-\033[0m");
+        }
+        mark(point.ema, candleLeft + candleCenterOffset, "\033[35m+\033[0m");
+        mark(point.sma, candleLeft + candleCenterOffset, "\033[33m*\033[0m");
+    }
+}
+
 void CandlesticksCollection::plotStackedBarsOnGrid(PlotData& pd)
 {
     //column set up (timeframe dependent)
@@ -252,7 +368,13 @@ void CandlesticksCollection::plotCandlesticks() {
 
     PlotData pd = initializePlotData();
     plotCandlesticksOnGrid(pd);
+    if (indicatorWindow > 0) plotIndicatorsOnGrid(pd);
     printPlot(pd, timestamps, 4);
+
+    if (indicatorWindow > 0) {
+        std::cout << "\nLegend (" << indicatorWindow << " periods):" << std::endl;
+        std::cout << "\033[33m*\033[0m SMA  \033[35m+\033[0m EMA  \033[36m-\033[0m Bands  \033[34m=\033[0m Rolling High/Low" << std::endl;
+    }
 }
 
 void CandlesticksCollection::plotStackedBars() {
@@ -314,37 +436,16 @@ vector<Candlestick> CandlesticksCollection::predictNextPeriods(int periodsToPred
         }
     }
     else {  // monthly
-        // create arrays to store average temperatures for each month
-        vector<float> monthlyAvgHigh(12, 0);
-        vector<float> monthlyAvgLow(12, 0);
-        vector<float> monthlyAvgClose(12, 0);
-        vector<float> monthlyAvgOpen(12, 0);
-        vector<int> monthCounts(12, 0);
-
-        // calculation of avg temp for each month
-        for (Candlestick& cs : candlesticks) {
-            int month = stoi(cs.timestamp.substr(5, 2)) - 1; // 0-based month index
-            monthlyAvgHigh[month] += cs.high;
-            monthlyAvgLow[month] += cs.low;
-            monthlyAvgClose[month] += cs.close;
-            monthlyAvgOpen[month] += cs.open;  // Track open values
-            monthCounts[month]++;
-        }
-
-        // averagin all counts
-        for (int i = 0; i < 12; i++) {
-            if (monthCounts[i] > 0) {
-                monthlyAvgHigh[i] /= monthCounts[i];
-                monthlyAvgLow[i] /= monthCounts[i];
-                monthlyAvgClose[i] /= monthCounts[i];
-                monthlyAvgOpen[i] /= monthCounts[i];
-            }
-        }
+        // average open/high/low/close of each month of the year over the series
+        CyclicProfile seasonal = CyclicProfile::ofCandles(candlesticks, Cycle::MonthOfYear, country);
+        const vector<CycleBucket>& months = seasonal.profile(country);
 
         // get last known values for future timestamps references
-        string lastTimestamp = candlesticks.back().timestamp;
-        int currentYear = stoi(lastTimestamp.substr(0, 4));
-        int currentMonth = stoi(lastTimestamp.substr(5, 2));
+        string lastTimestamp = candlesticks.back().timestamp + "-01";
+        int lastStamp = WeatherTable::packStamp(lastTimestamp.c_str(), lastTimestamp.size());
+        if (lastStamp < 0) return predictions;
+        int currentYear = WeatherTable::yearOf(lastStamp);
+        int currentMonth = WeatherTable::monthOf(lastStamp);
 
         // actual predictions
         for (int i = 0; i < periodsToPredict; i++) {
@@ -360,10 +461,11 @@ vector<Candlestick> CandlesticksCollection::predictNextPeriods(int periodsToPred
             float randomFactor = 0.1f;
             float random = ((static_cast<float>(rand()) / RAND_MAX) - 0.5f) * 2 * randomFactor;
 
-            float predictedOpen = monthlyAvgOpen[monthIndex] * (1 + random);
-            float predictedHigh = monthlyAvgHigh[monthIndex] * (1 + random);
-            float predictedLow = monthlyAvgLow[monthIndex] * (1 + random);
-            float predictedClose = monthlyAvgClose[monthIndex] * (1 + random);
+            const CycleBucket& month = months[monthIndex];
+            float predictedOpen = static_cast<float>(month.open()) * (1 + random);
+            float predictedHigh = static_cast<float>(month.high()) * (1 + random);
+            float predictedLow = static_cast<float>(month.low()) * (1 + random);
+            float predictedClose = static_cast<float>(month.close()) * (1 + random);
 
             // checking predictions maintain proper high/low relationship
             predictedHigh = max(predictedHigh, max(predictedLow, predictedClose));
@@ -1,6 +1,7 @@
 #pragma once 
 #include "Candlestick.h"
 #include "CsvReader.h"
+#include "DatasetSnapshot.h"
 #include <vector>
 #include <string>
 using namespace std;
@@ -21,10 +22,13 @@ public:
         filename(""),
         country(""),
         timeframe(Timeframe::Yearly),
+        year("0"),
         minTemp(numeric_limits<float>::lowest()),
         maxTemp(numeric_limits<float>::max()),
         startDate(""),
-        endDate("")
+        endDate(""),
+        extendedStats(false),
+        maxGapFill(0)
     {
     };
     CandlesticksCollection(
@@ -35,24 +39,30 @@ public:
         float minTemp = numeric_limits<float>::lowest(),
         float maxTemp = numeric_limits<float>::max(),
         string startDate = "",
-        string endDate = ""
+        string endDate = "",
+        bool extendedStats = false,
+        int maxGapFill = 0
     );
-    // assignment operator overloading needed for updating candlestick collection based on user input in weather app menu
-    CandlesticksCollection& operator=(const CandlesticksCollection& other) {
-        if (this != &other) {
-            filename = other.filename;
-            country = other.country;
-            timeframe = other.timeframe;
-            candlesticks = other.candlesticks;
-            startDate = other.startDate;
-            endDate = other.endDate;
-            minTemp = other.minTemp;
-            maxTemp = other.maxTemp;
-        }
-        return *this;
-    }
+    // same query answered from an in-memory dataset snapshot instead of reading the file
+    CandlesticksCollection(
+        const DatasetSnapshot& snapshot,
+        string country,
+        Timeframe timeframe,
+        string year = "0",
+        float minTemp = numeric_limits<float>::lowest(),
+        float maxTemp = numeric_limits<float>::max(),
+        string startDate = "",
+        string endDate = "",
+        bool extendedStats = false,
+        int maxGapFill = 0
+    );
+    // copy and assignment needed for updating candlestick collection based on user input in weather app menu
+    // every member is copied, so both are left to the compiler
+    CandlesticksCollection(const CandlesticksCollection& other) = default;
+    CandlesticksCollection& operator=(const CandlesticksCollection& other) = default;
     static string timeframeToString(Timeframe timeframe);
     void displayCandlesticks();
+    void displayCoverage();
     void plotCandlesticks();
     void plotStackedBars();
     void printPlot(
@@ -63,7 +73,14 @@ public:
     PlotData initializePlotData(float degPerRow = 1.0, float padding = 2.0);
     void plotStackedBarsOnGrid(PlotData& pd);
     void plotCandlesticksOnGrid(PlotData& pd);
+    void plotIndicatorsOnGrid(PlotData& pd);
     vector<Candlestick> predictNextPeriods(int periodsToPredict);
+    // same settings over a derived series (e.g. anomalies), without re-reading the data
+    CandlesticksCollection withCandlesticks(const vector<Candlestick>& derived) const;
+    const vector<Candlestick>& getCandlesticks() const { return candlesticks; }
+    const string& getCountry() const { return country; }
+    // moving averages, bands and rolling extremes over window candles in tables and plots, 0 = off
+    void setIndicators(int window, double bandWidth = 2.0);
 
 
 private:
@@ -76,6 +93,10 @@ private:
     float maxTemp;
     string startDate;
     string endDate;
+    bool extendedStats; // stddev/median/p10/p90 per candle
+    int maxGapFill; // hours, 0 = missing readings are skipped
+    int indicatorWindow = 0;
+    double bandWidth = 2.0; // standard deviations
     // helper function to map temperature to y axis
     float scaleTemp(double temp, double minTemp, double degreesPerRow, int numRows);
 };
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "Climatology.h"
+#include "DatasetManifest.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <algorithm>
+using namespace std;
+
+static const int daysInMonth[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+static bool isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int Climatology::dayIndex(int month, int day) {
+    int index = day - 1;
+    for (int m = 1; m < month; m++) {
+        index += daysInMonth[m - 1];
+    }
+    return index;
+}
+
+string Climatology::cachePath(const string& datasetPath, int startYear, int endYear) {
+    string suffix = "climatology_" + to_string(startYear) + "-" + to_string(endYear) + ".cache";
+    return DatasetManifest::isPartitioned(datasetPath) ? datasetPath + "/" + suffix : datasetPath + "." + suffix;
+}
+
+bool Climatology::isCacheFile(const string& fileName) {
+    auto endsWith = [&](const string& suffix) {
+        return fileName.size() >= suffix.size() && fileName.compare(fileName.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    // earlier versions wrote the cache as climatology_S-E.csv, still found in existing directories
+    return fileName.find("climatology_") != string::npos && (endsWith(".cache") || endsWith(".csv"));
+}
+
+string Climatology::sourceOf(const DatasetSnapshot& snapshot) {
+    // region columns depend on regions.cfg, whose contents can change without a newer modification time
+    return to_string(snapshot.modifiedTime) + "-" + snapshot.regionsFingerprint;
+}
+
+Climatology Climatology::loadOrBuild(const DatasetSnapshot& snapshot, int startYear, int endYear) {
+    Climatology climatology;
+    string cacheFile = cachePath(snapshot.path, startYear, endYear);
+    string source = sourceOf(snapshot);
+    if (load(cacheFile, climatology) && climatology.source == source) {
+        return climatology;
+    }
+
+    cout << "Building " << startYear << "-" << endYear << " climatology (done once, then cached)..." << endl;
+    // only the partitions of the reference period are read
+    climatology = build(snapshot.table({}, to_string(startYear), to_string(endYear)), startYear, endYear);
+    climatology.source = source;
+    climatology.save(cacheFile);
+    return climatology;
+}
+
+Climatology Climatology::build(const WeatherTable& table, int startYear, int endYear) {
+    Climatology climatology;
+    climatology.startYear = startYear;
+    climatology.endYear = endYear;
+    climatology.columnNames = table.columnNames;
+
+    // day of year is resolved once per row and shared by every column
+    vector<int> dayOfRow(table.numRows());
+    for (size_t r = 0; r < table.numRows(); r++) {
+        int stamp = table.stamps[r];
+        int year = WeatherTable::yearOf(stamp);
+        // -1 (skipped) outside the reference period, stamps are valid dates (see WeatherTable::packStamp)
+        dayOfRow[r] = (year < startYear || year > endYear) ? -1 :
+            dayIndex(WeatherTable::monthOf(stamp), WeatherTable::dayOf(stamp));
+    }
+
+    for (const vector<float>& values : table.columns) {
+        vector<double> sum(daysPerYear, 0.0), sumSquares(daysPerYear, 0.0);
+        vector<int> count(daysPerYear, 0);
+        const float* data = values.data();
+        const int* days = dayOfRow.data();
+        for (size_t r = 0; r < values.size(); r++) {
+            int day = days[r];
+            float value = data[r];
+            if (day < 0 || WeatherTable::isMissing(value)) continue;
+            sum[day] += value;
+            sumSquares[day] += static_cast<double>(value) * value;
+            count[day]++;
+        }
+
+        vector<float> mean(daysPerYear, WeatherTable::missing());
+        vector<float> stddev(daysPerYear, WeatherTable::missing());
+        for (int d = 0; d < daysPerYear; d++) {
+            if (count[d] == 0) continue;
+            double m = sum[d] / count[d];
+            double variance = count[d] > 1 ? (sumSquares[d] - count[d] * m * m) / (count[d] - 1) : 0.0;
+            mean[d] = static_cast<float>(m);
+            stddev[d] = static_cast<float>(sqrt(max(0.0, variance)));
+        }
+        climatology.means.push_back(mean);
+        climatology.stddevs.push_back(stddev);
+    }
+    return climatology;
+}
+
+bool Climatology::load(const string& cacheFile, Climatology& climatology) {
+    ifstream file(cacheFile);
+    if (!file.is_open()) return false;
+
+    string line;
+    if (!getline(file, line)) return false; // reference period header
+    vector<string> period = CSVReader::tokenise(line, ',');
+    if (period.size() < 3) return false;
+    try {
+        climatology.startYear = stoi(period[1]);
+        climatology.endYear = stoi(period[2]);
+    }
+    catch (const exception& e) {
+        return false;
+    }
+    climatology.source = period.size() > 3 ? period[3] : "";
+
+    getline(file, line); // column,day,mean,stddev header
+    while (getline(file, line)) {
+        if (line.empty()) continue;
+        vector<string> tokens = CSVReader::tokenise(line, ',');
+        if (tokens.size() < 4) continue;
+        int index = climatology.indexOf(tokens[0]);
+        if (index == -1) {
+            climatology.columnNames.push_back(tokens[0]);
+            climatology.means.push_back(vector<float>(daysPerYear, WeatherTable::missing()));
+            climatology.stddevs.push_back(vector<float>(daysPerYear, WeatherTable::missing()));
+            index = static_cast<int>(climatology.columnNames.size()) - 1;
+        }
+        try {
+            int day = stoi(tokens[1]);
+            if (day < 0 || day >= daysPerYear) continue;
+            climatology.means[index][day] = stof(tokens[2]);
+            climatology.stddevs[index][day] = stof(tokens[3]);
+        }
+        catch (const exception& e) {
+            cerr << "Warning: Invalid climatology entry '" << line << "'. Skipping line." << endl;
+        }
+    }
+    return true;
+}
+
+void Climatology::save(const string& cacheFile) const {
+    ofstream file(cacheFile);
+    if (!file.is_open()) {
+        cerr << "Warning: Could not cache climatology to '" << cacheFile << "'." << endl;
+        return;
+    }
+    file << "period," << startYear << "," << endYear << "," << source << '\n';
+    file << "column,day,mean,stddev" << '\n';
+    file << fixed << setprecision(4);
+    for (size_t c = 0; c < columnNames.size(); c++) {
+        for (int d = 0; d < daysPerYear; d++) {
+            if (WeatherTable::isMissing(means[c][d])) continue;
+            file << columnNames[c] << "," << d << "," << means[c][d] << "," << stddevs[c][d] << '\n';
+        }
+    }
+}
+
+int Climatology::indexOf(const string& column) const {
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        if (columnNames[i] == column) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool Climatology::hasColumn(const string& column) const {
+    return indexOf(column) != -1;
+}
+
+float Climatology::dailyMean(const string& column, int dayIndex) const {
+    int index = indexOf(column);
+    if (index == -1) throw invalid_argument("Country not found");
+    return means[index][dayIndex];
+}
+
+float Climatology::dailyStddev(const string& column, int dayIndex) const {
+    int index = indexOf(column);
+    if (index == -1) throw invalid_argument("Country not found");
+    return stddevs[index][dayIndex];
+}
+
+float Climatology::periodMean(const string& column, const string& timestamp) const {
+    int index = indexOf(column);
+    if (index == -1) throw invalid_argument("Country not found");
+
+    int year = stoi(timestamp.substr(0, 4));
+    int firstMonth = 1, lastMonth = 12;
+    if (timestamp.size() >= 7) {
+        firstMonth = lastMonth = stoi(timestamp.substr(5, 2));
+        if (firstMonth < 1 || firstMonth > 12) return WeatherTable::missing();
+    }
+
+    double sum = 0.0;
+    int count = 0;
+    for (int month = firstMonth; month <= lastMonth; month++) {
+        int days = (month == 2 && !isLeapYear(year)) ? 28 : daysInMonth[month - 1];
+        for (int day = 1; day <= days; day++) {
+            float mean = means[index][dayIndex(month, day)];
+            if (WeatherTable::isMissing(mean)) continue;
+            sum += mean;
+            count++;
+        }
+    }
+    return count > 0 ? static_cast<float>(sum / count) : WeatherTable::missing();
+}
+
+vector<Candlestick> Climatology::anomalies(const string& column, const vector<Candlestick>& candlesticks) const {
+    vector<Candlestick> result;
+    float previousClose = 0.0f;
+    for (const Candlestick& cs : candlesticks) {
+        float baseline = periodMean(column, cs.timestamp);
+        if (WeatherTable::isMissing(baseline)) continue; // no reference data for this period
+
+        double close = cs.close - baseline;
+        // same convention as the original series: open is the previous close
+        double open = result.empty() ? close : previousClose;
+        Candlestick anomaly(open, cs.high - baseline, cs.low - baseline, close, cs.timestamp);
+        anomaly.stats = cs.stats;
+        anomaly.coverage = cs.coverage;
+        if (anomaly.stats.available) {
+            anomaly.stats.median -= baseline;
+            anomaly.stats.p10 -= baseline;
+            anomaly.stats.p90 -= baseline;
+        }
+        result.push_back(anomaly);
+        previousClose = static_cast<float>(close);
+    }
+    return result;
+}
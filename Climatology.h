@@ -0,0 +1,48 @@
+#pragma once
+#include "WeatherTable.h"
+#include "DatasetSnapshot.h"
+#include "Candlestick.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+// per country mean and spread of every day of the year over a reference period (e.g. 1981-2010)
+// days are indexed on a 366 day calendar so that Feb 29 never shifts the rest of the year
+class Climatology {
+public:
+    static const int daysPerYear = 366;
+
+    // reuse the baseline cached next to the dataset, building it from the snapshot on first use or
+    // when the cache was built from older source files
+    static Climatology loadOrBuild(const DatasetSnapshot& snapshot, int startYear, int endYear);
+    // identifies the source data a baseline is built from (modification time and region definitions),
+    // stored in the cache header
+    static string sourceOf(const DatasetSnapshot& snapshot);
+    // single pass over each column of the table, rows outside the reference period are ignored
+    static Climatology build(const WeatherTable& table, int startYear, int endYear);
+    // not a .csv, and inside a partitioned directory, so it is never taken for a partition
+    static string cachePath(const string& datasetPath, int startYear, int endYear);
+    static bool isCacheFile(const string& fileName);
+    static bool load(const string& cacheFile, Climatology& climatology);
+    void save(const string& cacheFile) const;
+
+    static int dayIndex(int month, int day); // month and day of a valid date
+
+    bool hasColumn(const string& column) const;
+    float dailyMean(const string& column, int dayIndex) const;
+    float dailyStddev(const string& column, int dayIndex) const;
+    // average baseline over a candlestick period (YYYY or YYYY-MM)
+    float periodMean(const string& column, const string& timestamp) const;
+    // express candlesticks as deviations from the baseline of their period
+    vector<Candlestick> anomalies(const string& column, const vector<Candlestick>& candlesticks) const;
+
+    int startYear = 0;
+    int endYear = 0;
+    string source; // sourceOf the snapshot it was built from, empty in caches from older versions
+    vector<string> columnNames;
+    vector<vector<float>> means; // [column][day]
+    vector<vector<float>> stddevs;
+
+private:
+    int indexOf(const string& column) const;
+};
@@ -0,0 +1,223 @@
+#include "CorrelationAnalysis.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <stdexcept>
+#include <cmath>
+using namespace std;
+
+// tile of the result matrix kept in L1 while all periods stream through it
+static const size_t tileRows = 16;
+static const size_t tileCols = 32;
+
+PeriodMatrix CorrelationAnalysis::periodMeans(const WeatherTable& table, Timeframe timeframe) {
+    size_t numColumns = table.columns.size();
+
+    // periods are calendar years (or months) counted from the first one, so a period without rows still
+    // takes its place and a lag always shifts by calendar periods
+    vector<int> periodOfRow(table.numRows());
+    int firstKey = 0;
+    int lastKey = -1;
+    for (size_t r = 0; r < table.numRows(); r++) {
+        int stamp = table.stamps[r];
+        int key = timeframe == Timeframe::Yearly ? WeatherTable::yearOf(stamp) :
+            WeatherTable::yearOf(stamp) * 12 + WeatherTable::monthOf(stamp) - 1;
+        if (r == 0 || key < firstKey) firstKey = key;
+        if (r == 0 || key > lastKey) lastKey = key;
+        periodOfRow[r] = key;
+    }
+    for (int& period : periodOfRow) {
+        period -= firstKey;
+    }
+
+    PeriodMatrix periods;
+    periods.numPeriods = static_cast<size_t>(lastKey - firstKey + 1);
+    periods.numColumns = numColumns;
+    vector<double> sums(periods.numPeriods * numColumns, 0.0);
+    vector<int> counts(periods.numPeriods * numColumns, 0);
+    for (size_t c = 0; c < numColumns; c++) {
+        const float* values = table.columns[c].data();
+        for (size_t r = 0; r < table.numRows(); r++) {
+            if (WeatherTable::isMissing(values[r])) continue;
+            size_t cell = periodOfRow[r] * numColumns + c;
+            sums[cell] += values[r];
+            counts[cell]++;
+        }
+    }
+
+    // every mean is shifted by the same offset, which keeps the sums small without changing any correlation
+    double total = 0.0;
+    size_t valid = 0;
+    for (size_t cell = 0; cell < sums.size(); cell++) {
+        if (counts[cell] == 0) continue;
+        sums[cell] /= counts[cell];
+        total += sums[cell];
+        valid++;
+    }
+    double offset = valid > 0 ? total / valid : 0.0;
+
+    periods.values.assign(sums.size(), 0.0);
+    periods.squares.assign(sums.size(), 0.0);
+    periods.valid.assign(sums.size(), 0.0);
+    for (size_t cell = 0; cell < sums.size(); cell++) {
+        if (counts[cell] == 0) continue; // missing periods stay 0 in all three, so they drop out of every sum
+        double value = sums[cell] - offset;
+        periods.values[cell] = value;
+        periods.squares[cell] = value * value;
+        periods.valid[cell] = 1.0;
+    }
+    return periods;
+}
+
+void CorrelationAnalysis::blockedProducts(const PeriodMatrix& periods, int lag, unsigned numThreads, vector<double>& result) {
+    size_t numPeriods = periods.numPeriods;
+    size_t numColumns = periods.numColumns;
+    size_t overlap = numPeriods > static_cast<size_t>(lag) ? numPeriods - lag : 0;
+    bool symmetric = lag == 0;
+
+    // tiles of the result matrix, only the upper triangle when there is no lag
+    vector<pair<size_t, size_t>> tiles;
+    for (size_t ib = 0; ib < numColumns; ib += tileRows) {
+        for (size_t jb = 0; jb < numColumns; jb += tileCols) {
+            if (symmetric && jb + tileCols <= ib) continue;
+            tiles.emplace_back(ib, jb);
+        }
+    }
+
+    // pearson over the periods where both columns have a reading:
+    // count, sums, sums of squares and cross products of the pairs, masked by the validity of the other column
+    enum { Count, SumA, SumB, SquaresA, SquaresB, Products, NumSums };
+    atomic<size_t> nextTile(0);
+    auto worker = [&]() {
+        vector<double> acc(NumSums * tileRows * tileCols);
+        size_t index;
+        while ((index = nextTile++) < tiles.size()) {
+            size_t ib = tiles[index].first, jb = tiles[index].second;
+            size_t iEnd = min(ib + tileRows, numColumns), jEnd = min(jb + tileCols, numColumns);
+            size_t width = jEnd - jb;
+            fill(acc.begin(), acc.end(), 0.0);
+
+            // rank-1 updates per period: contiguous, branch-free inner loop the compiler vectorises
+            for (size_t t = 0; t < overlap; t++) {
+                size_t rowA = t * numColumns;
+                size_t rowB = (t + lag) * numColumns + jb;
+                const double* bValue = &periods.values[rowB];
+                const double* bSquare = &periods.squares[rowB];
+                const double* bValid = &periods.valid[rowB];
+                for (size_t i = ib; i < iEnd; i++) {
+                    double aValue = periods.values[rowA + i];
+                    double aSquare = periods.squares[rowA + i];
+                    double aValid = periods.valid[rowA + i];
+                    double* sums = &acc[(i - ib) * tileCols];
+                    const size_t plane = tileRows * tileCols;
+                    for (size_t j = 0; j < width; j++) {
+                        sums[Count * plane + j] += aValid * bValid[j];
+                        sums[SumA * plane + j] += aValue * bValid[j];
+                        sums[SumB * plane + j] += aValid * bValue[j];
+                        sums[SquaresA * plane + j] += aSquare * bValid[j];
+                        sums[SquaresB * plane + j] += aValid * bSquare[j];
+                        sums[Products * plane + j] += aValue * bValue[j];
+                    }
+                }
+            }
+
+            const size_t plane = tileRows * tileCols;
+            for (size_t i = ib; i < iEnd; i++) {
+                for (size_t j = jb; j < jEnd; j++) {
+                    const double* sums = &acc[(i - ib) * tileCols + (j - jb)];
+                    double n = sums[Count * plane];
+                    double covariance = n * sums[Products * plane] - sums[SumA * plane] * sums[SumB * plane];
+                    double varianceA = n * sums[SquaresA * plane] - sums[SumA * plane] * sums[SumA * plane];
+                    double varianceB = n * sums[SquaresB * plane] - sums[SumB * plane] * sums[SumB * plane];
+                    // fewer than two shared periods or a constant column: reported as uncorrelated
+                    double correlation = (n >= 2 && varianceA > 0.0 && varianceB > 0.0) ?
+                        covariance / sqrt(varianceA * varianceB) : 0.0;
+                    result[i * numColumns + j] = max(-1.0, min(1.0, correlation));
+                }
+            }
+        }
+    };
+
+    vector<thread> threads;
+    for (unsigned t = 1; t < numThreads; t++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : threads) {
+        t.join();
+    }
+
+    if (symmetric) {
+        for (size_t i = 0; i < numColumns; i++) {
+            for (size_t j = 0; j < i; j++) {
+                result[i * numColumns + j] = result[j * numColumns + i];
+            }
+        }
+    }
+}
+
+CorrelationResult CorrelationAnalysis::compute(const WeatherTable& table,
+    Timeframe timeframe,
+    int lag,
+    unsigned numThreads)
+{
+    if (lag < 0) {
+        throw invalid_argument("Lag must not be negative");
+    }
+    if (numThreads == 0) {
+        numThreads = max(1u, thread::hardware_concurrency());
+    }
+
+    CorrelationResult result;
+    result.columnNames = table.columnNames;
+    result.lag = lag;
+
+    size_t numColumns = table.columns.size();
+    PeriodMatrix periods = periodMeans(table, timeframe);
+    result.numPeriods = periods.numPeriods;
+    result.matrix.assign(numColumns * numColumns, 0.0);
+    blockedProducts(periods, lag, numThreads, result.matrix);
+    return result;
+}
+
+vector<pair<string, double>> CorrelationResult::mostSimilar(const string& column, size_t k) const {
+    size_t n = columnNames.size();
+    size_t index = find(columnNames.begin(), columnNames.end(), column) - columnNames.begin();
+    if (index == n) {
+        throw invalid_argument("Country not found");
+    }
+
+    vector<pair<string, double>> similar;
+    for (size_t j = 0; j < n; j++) {
+        if (j != index) similar.emplace_back(columnNames[j], at(index, j));
+    }
+    size_t count = min(k, similar.size());
+    partial_sort(similar.begin(), similar.begin() + count, similar.end(),
+        [](const pair<string, double>& a, const pair<string, double>& b) { return a.second > b.second; });
+    similar.resize(count);
+    return similar;
+}
+
+void CorrelationResult::print() const {
+    // column labels are shortened to the country code (AT_temperature -> AT)
+    vector<string> labels;
+    for (const string& name : columnNames) {
+        labels.push_back(name.substr(0, name.find('_')));
+    }
+
+    cout << fixed << setprecision(2);
+    cout << setw(6) << " ";
+    for (const string& label : labels) {
+        cout << setw(6) << label.substr(0, 5);
+    }
+    cout << endl;
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        cout << setw(6) << left << labels[i].substr(0, 5) << right;
+        for (size_t j = 0; j < columnNames.size(); j++) {
+            cout << setw(6) << at(i, j);
+        }
+        cout << endl;
+    }
+}
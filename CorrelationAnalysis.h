@@ -0,0 +1,44 @@
+#pragma once
+#include "WeatherTable.h"
+#include "CsvReader.h"
+#include <vector>
+#include <string>
+#include <utility>
+using namespace std;
+
+// pearson correlation between every pair of columns, optionally with column j lagged behind column i
+struct CorrelationResult {
+    vector<string> columnNames;
+    int lag = 0;
+    size_t numPeriods = 0;
+    vector<double> matrix; // row major, [i * n + j] = corr(column i at t, column j at t + lag), 0 when undefined
+
+    double at(size_t i, size_t j) const { return matrix[i * columnNames.size() + j]; }
+    // k most correlated other columns, strongest first
+    vector<pair<string, double>> mostSimilar(const string& column, size_t k) const;
+    void print() const;
+};
+
+// period x column matrices (row major) of period means, their squares and 1/0 validity; 0 where missing
+struct PeriodMatrix {
+    size_t numPeriods = 0;
+    size_t numColumns = 0;
+    vector<double> values;
+    vector<double> squares;
+    vector<double> valid;
+};
+
+class CorrelationAnalysis {
+public:
+    // columns are first reduced to per-period means (yearly or monthly); each pair is then correlated over the
+    // periods where both have a mean (for a lag, column i at t and column j at t + lag calendar periods), using sums that a
+    // blocked multithreaded kernel accumulates for all pairs at once
+    static CorrelationResult compute(const WeatherTable& table,
+        Timeframe timeframe,
+        int lag = 0,
+        unsigned numThreads = 0);
+
+private:
+    static PeriodMatrix periodMeans(const WeatherTable& table, Timeframe timeframe);
+    static void blockedProducts(const PeriodMatrix& periods, int lag, unsigned numThreads, vector<double>& result);
+};
@@ -1,47 +1,18 @@
 #include "CsvReader.h"
 #include "Candlestick.h"
+#include "DatasetManifest.h"
+#include "StreamingStats.h"
+#include "DataQuality.h"
+#include "WeatherTable.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <cstdio>
+#include <cmath>
 using namespace std;
 
 CSVReader::CSVReader() {}
 
-//set up filter strucutre defaulting both temp and date filters to be fully inclusive of original dataset values
-struct DataFilters {
-    float minTemp = numeric_limits<float>::lowest();
-    float maxTemp = numeric_limits<float>::max();
-    string startDate = "";
-    string endDate = "";
-
-    bool isInTempRange(float temp) const {
-        return temp >= minTemp && temp <= maxTemp;
-    }
-
-    bool isInDateRange(const string& date) const {
-        if (startDate.empty() && endDate.empty()) return true;
-        if (startDate.empty()) return date <= endDate;
-        if (endDate.empty()) return date >= startDate;
-        return date >= startDate && date <= endDate;
-    }
-};
-
-string CSVReader::getDateSubstr(const string& date, Timeframe timeframe, string year) {
-
-    if (timeframe == Timeframe::Monthly && year != "0") {
-        string dateYear = date.substr(0, 4);
-        if (dateYear != year) {
-            return "";
-        }
-        string month = date.substr(5, 2);
-        return year + "-" + month;
-    }
-    else {
-        return date.substr(0, 4);
-    }
-
-}
-
 vector<string> CSVReader::tokenise(string csvLine, char separator) {
     vector<string> tokens;
     string token;
@@ -52,115 +23,220 @@ vector<string> CSVReader::tokenise(string csvLine, char separator) {
     return tokens;
 }
 
-vector<Candlestick> CSVReader::computeCandlesticks(const string& filePath,
-const string& country,
-const Timeframe& timeframe,
-const string year,
-float minTemp,
-float maxTemp,
-string startDate,
-string endDate
-) {
-
-    ifstream file(filePath);
-    if (!file.is_open()) {
-        cerr << "Error: Could not open the file." << endl;
-        return {};
-    }
+// running state of the candlestick being built, kept across files and row loop specialisations
+struct AggregationState {
+    AggregationState(bool extendedStats, int maxGapFill) : group{ extendedStats }, maxGapFill{ maxGapFill } {}
 
-    //setting up filters based on user input values (if specified)
-    DataFilters filters{ minTemp, maxTemp, startDate, endDate };
     vector<Candlestick> candlesticks;
-    string line;
+    string currentDateGroup;
+    PeriodAccumulator group; // sum, count, high/low (and distribution) of current timeframe
+    float previousClose = 0.0f;
+    bool firstGroup = true;
 
-    if (!getline(file, line)) {
-        cerr << "Error: File is empty." << endl;
-        return {};
+    // last valid reading, for interpolating short gaps
+    int maxGapFill;
+    bool hasLastReading = false;
+    long long lastReadingHour = 0;
+    vector<float> gapValues; // reused buffer for the interpolated run of a gap
+    float lastReading = 0.0f;
+
+    void addReading(const string& dateGroup, float temperature, const DataFilters& filters) {
+        startGroup(dateGroup, filters);
+        // keep summing temperature data as long as entries have the same dategroup
+        group.add(temperature);
     }
 
-    // find specified country column index
-    vector<string> headers = tokenise(line, ',');
-    int countryIndex = -1;
-    for (int i = 0; i < headers.size(); ++i) {
-        if (headers[i] == country) {
-            countryIndex = i;
-            break;
+    // interpolated readings of a gap, all within one date group
+    void addFilled(const string& dateGroup, const float* temperatures, size_t count, const DataFilters& filters) {
+        startGroup(dateGroup, filters);
+        group.addFilled(temperatures, count);
+    }
+
+    void startGroup(const string& dateGroup, const DataFilters& filters) {
+        if (currentDateGroup != dateGroup) {
+            if (!currentDateGroup.empty()) {
+                closeGroup(filters);
+            }
+            currentDateGroup = dateGroup;
         }
     }
 
-    if (countryIndex == -1) {
-        cerr << "Error: Country '" << country << "' not found in the header." << endl;
-        throw invalid_argument("Country not found");
+    // Calculate candlestick data for the completed group
+    void closeGroup(const DataFilters& filters) {
+        float close = group.close();
+        // if no previous time frame, default first group open to its close
+        float open = firstGroup ? close : previousClose;
+        if (group.high <= filters.maxTemp && group.low >= filters.minTemp) {
+            candlesticks.push_back(group.toCandlestick(open, currentDateGroup));
+        }
+        // resetting for next candlestick
+        group.reset();
+        previousClose = close; // setting the close of this group as the open for the next
+        firstGroup = false;
     }
+};
 
-    string currentDateGroup;
-    float sumTemperatures = 0.0f;
-    int tempCount = 0; // count of temp for current timeframe
-    float high = numeric_limits<float>::lowest();
-    float low = numeric_limits<float>::max();
-    float previousClose = 0.0f;
-    bool firstGroup = true;
+// feed linearly interpolated readings for the missing hours between the last valid reading and this one
+template <Timeframe TF, DateBounds Bounds>
+static void fillGap(long long hour, float temperature, const string& year, const DataFilters& filters, AggregationState& state) {
+    if (!state.hasLastReading) return;
+    size_t filled = DataQuality::interpolateRun(state.lastReadingHour, state.lastReading, hour, temperature,
+        state.maxGapFill, state.gapValues);
+    char dateGroup[16];
+    DataQuality::forEachPeriod(state.lastReadingHour + 1, filled, TF == Timeframe::Monthly,
+        [&](int stamp, size_t offset, size_t length) {
+            int gapYear = WeatherTable::yearOf(stamp);
+            if (TF == Timeframe::Monthly) {
+                if (to_string(gapYear) != year) return;
+                snprintf(dateGroup, sizeof(dateGroup), "%04d-%02d", gapYear, WeatherTable::monthOf(stamp));
+            }
+            else {
+                snprintf(dateGroup, sizeof(dateGroup), "%04d", gapYear);
+            }
+            if (!filters.isInDateRange<Bounds>(dateGroup)) return;
+            state.addFilled(dateGroup, state.gapValues.data() + offset, length, filters);
+        });
+}
+
+// row loop specialised at compile time on the date group (Monthly = months of one year), on the
+// date bounds in use and on gap filling, so each query runs a loop without timeframe or filter branches per row
+template <Timeframe TF, DateBounds Bounds, bool FillGaps>
+static void aggregateRows(istream& file, size_t numColumns, int countryIndex, const string& year,
+    const DataFilters& filters, AggregationState& state)
+{
+    const size_t keyLength = (TF == Timeframe::Monthly) ? 7 : 4; // YYYY-MM or YYYY
+    string line;
+    // date group of the previous row, the date filter only runs when it changes
+    string rowGroup;
+    bool rowGroupInRange = false;
 
     while (getline(file, line)) {
         if (line.empty()) continue;
-        vector <string> tokens = tokenise(line, ',');
+        vector <string> tokens = CSVReader::tokenise(line, ',');
 
-        if (tokens.size() < headers.size()) {
+        if (tokens.size() < numColumns) {
             cerr << "Warning: Line has insufficient columns. Skipping line." << endl;
             continue;
         }
 
-        string date = getDateSubstr(tokens[0], timeframe, year);
-        if (!filters.isInDateRange(date)) continue; //skip if date is not in range
-
+        const string& timestamp = tokens[0];
+        if (TF == Timeframe::Monthly && timestamp.compare(0, 4, year) != 0) continue; // other year
+        if (timestamp.compare(0, keyLength, rowGroup) != 0) {
+            rowGroup = timestamp.substr(0, keyLength);
+            rowGroupInRange = !rowGroup.empty() && filters.isInDateRange<Bounds>(rowGroup);
+        }
+        if (!rowGroupInRange) continue; //skip if date is not in range
 
-        if (date.empty()) continue; //to avoid computing further for monthly candlesticks
         float temperature;
         try { //handle possible cases where column doesn't have valid values for temperature
             temperature = stof(tokens[countryIndex]);
+            if (!isfinite(temperature)) throw invalid_argument("not a finite temperature");
         }
-        catch (const invalid_argument& e) {
+        catch (const logic_error& e) { // invalid_argument, or out_of_range for values no float holds
             cerr << "Warning: Invalid temperature value '" << tokens[countryIndex] << "'. Skipping line." << endl;
             continue;
         }
 
-        if (currentDateGroup.empty()) {
-            currentDateGroup = date;
+        // a row that is not an existing date and hour is still aggregated under its date group, but has
+        // no place on the hourly timeline, so it neither fills nor ends a gap
+        int stamp = FillGaps ? WeatherTable::packStamp(timestamp.c_str(), timestamp.size()) : -1;
+        if (FillGaps && stamp >= 0) {
+            long long hour = DataQuality::hourOf(stamp);
+            fillGap<TF, Bounds>(hour, temperature, year, filters, state);
+            state.hasLastReading = true;
+            state.lastReadingHour = hour;
+            state.lastReading = temperature;
+        }
+        state.addReading(rowGroup, temperature, filters);
+    }
+}
+
+typedef void (*RowLoop)(istream&, size_t, int, const string&, const DataFilters&, AggregationState&);
+
+template <Timeframe TF, bool FillGaps>
+static RowLoop selectRowLoop(DateBounds bounds) {
+    switch (bounds) {
+    case DateBounds::Start: return &aggregateRows<TF, DateBounds::Start, FillGaps>;
+    case DateBounds::End: return &aggregateRows<TF, DateBounds::End, FillGaps>;
+    case DateBounds::Both: return &aggregateRows<TF, DateBounds::Both, FillGaps>;
+    default: return &aggregateRows<TF, DateBounds::None, FillGaps>;
+    }
+}
+
+template <bool FillGaps>
+static RowLoop selectRowLoop(Timeframe timeframe, const string& year, DateBounds bounds) {
+    // monthly without a year groups by year, exactly like the yearly timeframe
+    if (timeframe == Timeframe::Monthly && year != "0") {
+        return selectRowLoop<Timeframe::Monthly, FillGaps>(bounds);
+    }
+    return selectRowLoop<Timeframe::Yearly, FillGaps>(bounds);
+}
+
+// picked once per query
+static RowLoop selectRowLoop(Timeframe timeframe, const string& year, const DataFilters& filters, int maxGapFill) {
+    if (maxGapFill > 0) {
+        return selectRowLoop<true>(timeframe, year, filters.bounds());
+    }
+    return selectRowLoop<false>(timeframe, year, filters.bounds());
+}
+
+vector<Candlestick> CSVReader::computeCandlesticks(const string& filePath,
+const string& country,
+const Timeframe& timeframe,
+const string year,
+float minTemp,
+float maxTemp,
+string startDate,
+string endDate,
+bool extendedStats,
+int maxGapFill
+) {
+
+    // a partitioned dataset directory only opens the files overlapping the query
+    vector<string> files = DatasetManifest::resolveFiles(filePath, country, timeframe, year, startDate, endDate);
+
+    //setting up filters based on user input values (if specified)
+    DataFilters filters{ minTemp, maxTemp, startDate, endDate };
+    RowLoop rowLoop = selectRowLoop(timeframe, year, filters, maxGapFill);
+
+    // group state is kept across files so that partitions behave like one continuous file
+    AggregationState state(extendedStats, maxGapFill);
+
+    for (const string& path : files) {
+        ifstream file(path);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open the file." << endl;
+            return {};
+        }
+
+        string line;
+        if (!getline(file, line)) {
+            cerr << "Error: File is empty." << endl;
+            return {};
         }
-        if (date != currentDateGroup) {
-            // Calculate candlestick data for the completed group
-            float close = sumTemperatures / tempCount;
-            // if no previous time frame, default first group open to its close
-            float open = firstGroup ? close : previousClose;
-            if (high <= filters.maxTemp && low >= filters.minTemp) {
-                candlesticks.emplace_back(open, high, low, close, currentDateGroup);
+
+        // find specified country column index
+        vector<string> headers = tokenise(line, ',');
+        int countryIndex = -1;
+        for (int i = 0; i < headers.size(); ++i) {
+            if (headers[i] == country) {
+                countryIndex = i;
+                break;
             }
-            // resetting for next candlestick
-            currentDateGroup = date;
-            sumTemperatures = 0.0f;
-            tempCount = 0;
-            high = numeric_limits<float>::lowest();
-            low = numeric_limits<float>::max();
-            previousClose = close; // setting the close of this group as the open for the next
-            firstGroup = false;
         }
 
-        // keep summing temperature data as long as entries have the same dategroup
-        sumTemperatures += temperature;
-        tempCount++;
-        high = max(high, temperature);
-        low = min(low, temperature);
+        if (countryIndex == -1) {
+            cerr << "Error: Country '" << country << "' not found in the header." << endl;
+            throw invalid_argument("Country not found");
+        }
+
+        rowLoop(file, headers.size(), countryIndex, year, filters, state);
+        file.close();
     }
     //last group
-    if (tempCount > 0) {
-        if (high <= filters.maxTemp && low >= filters.minTemp) {
-
-            float close = sumTemperatures / tempCount;
-            float open = firstGroup ? close : previousClose;
-            candlesticks.emplace_back(open, high, low, close, currentDateGroup);
-        }
+    if (state.group.tempCount > 0) {
+        state.closeGroup(filters);
     }
 
-    file.close();
-    return candlesticks;
+    return state.candlesticks;
 }
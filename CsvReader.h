@@ -2,8 +2,45 @@
 #include "Candlestick.h"
 #include <vector>
 #include <string>
+#include <limits>
 enum class Timeframe { Yearly, Monthly };
 
+// which date filters the user set
+enum class DateBounds { None, Start, End, Both };
+
+//set up filter strucutre defaulting both temp and date filters to be fully inclusive of original dataset values
+struct DataFilters {
+    float minTemp = numeric_limits<float>::lowest();
+    float maxTemp = numeric_limits<float>::max();
+    string startDate = "";
+    string endDate = "";
+
+    bool isInDateRange(const string& date) const {
+        if (startDate.empty() && endDate.empty()) return true;
+        if (startDate.empty()) return date <= endDate;
+        if (endDate.empty()) return date >= startDate;
+        return date >= startDate && date <= endDate;
+    }
+
+    DateBounds bounds() const {
+        if (startDate.empty() && endDate.empty()) return DateBounds::None;
+        if (startDate.empty()) return DateBounds::End;
+        if (endDate.empty()) return DateBounds::Start;
+        return DateBounds::Both;
+    }
+
+    // same check as isInDateRange with the bounds case fixed at compile time
+    template <DateBounds Bounds>
+    bool isInDateRange(const string& date) const {
+        switch (Bounds) {
+        case DateBounds::None: return true;
+        case DateBounds::End: return date <= endDate;
+        case DateBounds::Start: return date >= startDate;
+        default: return date >= startDate && date <= endDate;
+        }
+    }
+};
+
 class CSVReader {
 
 public:
@@ -15,7 +52,8 @@ public:
     float minTemp = numeric_limits<float>::lowest(),
     float maxTemp = numeric_limits<float>::max(),
     string startDate = "",
-    string endDate = "");
+    string endDate = "",
+    bool extendedStats = false,
+    int maxGapFill = 0); // interpolate gaps of at most this many hours (0 = off)
     static vector<string> tokenise(string csvLine, char separator);
-    static string getDateSubstr(const std::string& date, Timeframe timeframe, string year);
 };
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "CyclicProfile.h"
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+void CycleBucket::addOccurrence(double open, double high, double low, double close) {
+    occurrences++;
+    sumOpen += open;
+    sumHigh += high;
+    sumLow += low;
+    sumClose += close;
+}
+
+int CyclicProfile::bucketCount(Cycle cycle) {
+    switch (cycle) {
+    case Cycle::HourOfDay: return 24;
+    case Cycle::DayOfWeek: return 7;
+    default: return 12;
+    }
+}
+
+string CyclicProfile::bucketLabel(Cycle cycle, int bucket) {
+    static const char* days[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+    static const char* months[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+    switch (cycle) {
+    case Cycle::HourOfDay: return (bucket < 10 ? "0" : "") + to_string(bucket) + ":00";
+    case Cycle::DayOfWeek: return days[bucket];
+    default: return months[bucket];
+    }
+}
+
+int CyclicProfile::dayOfWeek(int year, int month, int day) {
+    static const int offsets[12] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+    year -= month < 3;
+    return (year + year / 4 - year / 100 + year / 400 + offsets[month - 1] + day) % 7;
+}
+
+int CyclicProfile::bucketOf(Cycle cycle, int stamp) {
+    switch (cycle) {
+    case Cycle::HourOfDay: return WeatherTable::hourOf(stamp);
+    case Cycle::DayOfWeek: return dayOfWeek(WeatherTable::yearOf(stamp), WeatherTable::monthOf(stamp), WeatherTable::dayOf(stamp));
+    default: return WeatherTable::monthOf(stamp) - 1;
+    }
+}
+
+// stamps sharing a key belong to the same occurrence: the same hour, day or month
+static int occurrenceKey(Cycle cycle, int stamp) {
+    switch (cycle) {
+    case Cycle::HourOfDay: return stamp;
+    case Cycle::DayOfWeek: return stamp / 100;
+    default: return stamp / 10000;
+    }
+}
+
+// occurrence being accumulated for one column
+struct Occurrence {
+    int key = -1;
+    int bucket = 0;
+    float first = 0.0f;
+    float high = 0.0f;
+    float low = 0.0f;
+    double sum = 0.0;
+    int count = 0;
+};
+
+CyclicProfile CyclicProfile::build(const WeatherTable& table,
+    const vector<string>& columns,
+    Cycle cycle,
+    const string& startDate,
+    const string& endDate
+) {
+    int firstStamp = WeatherTable::boundStamp(startDate, false);
+    int lastStamp = WeatherTable::boundStamp(endDate, true);
+
+    CyclicProfile profile;
+    profile.cycle = cycle;
+    profile.columnNames = columns;
+    vector<const float*> data;
+    for (const string& column : columns) {
+        data.push_back(table.column(column).data());
+    }
+    size_t numColumns = columns.size();
+    profile.buckets.assign(numColumns, vector<CycleBucket>(bucketCount(cycle)));
+
+    vector<Occurrence> current(numColumns);
+    auto fold = [&](size_t c) {
+        Occurrence& occurrence = current[c];
+        if (occurrence.count == 0) return;
+        profile.buckets[c][occurrence.bucket].addOccurrence(occurrence.first, occurrence.high, occurrence.low,
+            occurrence.sum / occurrence.count);
+        occurrence.count = 0;
+    };
+
+    // the bucket is only worked out when the row starts a new occurrence
+    int rowKey = -1;
+    int bucket = 0;
+    for (size_t r = 0; r < table.numRows(); r++) {
+        int stamp = table.stamps[r];
+        if (stamp < firstStamp || stamp > lastStamp) continue;
+        int key = occurrenceKey(cycle, stamp);
+        if (key != rowKey) {
+            rowKey = key;
+            bucket = bucketOf(cycle, stamp);
+        }
+
+        for (size_t c = 0; c < numColumns; c++) {
+            float value = data[c][r];
+            if (WeatherTable::isMissing(value)) continue;
+            CycleBucket& target = profile.buckets[c][bucket];
+            target.count++;
+            target.sum += value;
+            target.min = min(target.min, value);
+            target.max = max(target.max, value);
+
+            Occurrence& occurrence = current[c];
+            if (occurrence.key != key || occurrence.count == 0) {
+                fold(c);
+                occurrence.key = key;
+                occurrence.bucket = bucket;
+                occurrence.first = occurrence.high = occurrence.low = value;
+                occurrence.sum = 0.0;
+            }
+            occurrence.high = max(occurrence.high, value);
+            occurrence.low = min(occurrence.low, value);
+            occurrence.sum += value;
+            occurrence.count++;
+        }
+    }
+    for (size_t c = 0; c < numColumns; c++) {
+        fold(c);
+    }
+    return profile;
+}
+
+CyclicProfile CyclicProfile::ofCandles(const vector<Candlestick>& candlesticks, Cycle cycle, const string& column) {
+    CyclicProfile profile;
+    profile.cycle = cycle;
+    profile.columnNames = { column };
+    profile.buckets.assign(1, vector<CycleBucket>(bucketCount(cycle)));
+    for (const Candlestick& candle : candlesticks) {
+        // yearly and monthly candles start on the first day of their period
+        string date = candle.timestamp;
+        if (date.size() == 4) date += "-01";
+        if (date.size() == 7) date += "-01";
+        int stamp = WeatherTable::packStamp(date.c_str(), date.size());
+        if (stamp < 0) continue;
+
+        CycleBucket& target = profile.buckets[0][bucketOf(cycle, stamp)];
+        target.count++;
+        target.sum += candle.close;
+        target.min = min(target.min, static_cast<float>(candle.low));
+        target.max = max(target.max, static_cast<float>(candle.high));
+        target.addOccurrence(candle.open, candle.high, candle.low, candle.close);
+    }
+    return profile;
+}
+
+const vector<CycleBucket>& CyclicProfile::profile(const string& column) const {
+    for (size_t c = 0; c < columnNames.size(); c++) {
+        if (columnNames[c] == column) return buckets[c];
+    }
+    throw invalid_argument("Country not found");
+}
+
+void CyclicProfile::print(const string& column) const {
+    const vector<CycleBucket>& rows = profile(column);
+    cout << "Position\tMean\tMin\tMax\tOpen\tHigh\tLow\tClose" << endl << endl;
+    cout << fixed;
+    cout.precision(3);
+    for (size_t b = 0; b < rows.size(); b++) {
+        const CycleBucket& bucket = rows[b];
+        cout << bucketLabel(cycle, static_cast<int>(b)) << "\t\t";
+        if (bucket.count == 0) {
+            cout << "-" << endl; // no readings at this position
+            continue;
+        }
+        cout << bucket.mean() << "\t" << bucket.min << "\t" << bucket.max << "\t"
+            << bucket.open() << "\t" << bucket.high() << "\t" << bucket.low() << "\t" << bucket.close() << endl;
+    }
+}
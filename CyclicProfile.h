@@ -0,0 +1,56 @@
+#pragma once
+#include "WeatherTable.h"
+#include "Candlestick.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+// repeating calendar positions readings are grouped by, unlike Timeframe's consecutive periods
+enum class Cycle { HourOfDay, DayOfWeek, MonthOfYear };
+
+// statistics of one position of the cycle (e.g. every 14:00, every Monday, every March)
+// open/high/low/close are averaged over the occurrences of the position: each occurrence is a
+// candle whose open is its first reading, high/low its extremes and close its mean
+struct CycleBucket {
+    long long count = 0;       // readings
+    int occurrences = 0;
+    double sum = 0.0;
+    float min = numeric_limits<float>::max();
+    float max = numeric_limits<float>::lowest();
+    double sumOpen = 0.0;
+    double sumHigh = 0.0;
+    double sumLow = 0.0;
+    double sumClose = 0.0;
+
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+    double open() const { return occurrences > 0 ? sumOpen / occurrences : 0.0; }
+    double high() const { return occurrences > 0 ? sumHigh / occurrences : 0.0; }
+    double low() const { return occurrences > 0 ? sumLow / occurrences : 0.0; }
+    double close() const { return occurrences > 0 ? sumClose / occurrences : 0.0; }
+    void addOccurrence(double open, double high, double low, double close);
+};
+
+class CyclicProfile {
+public:
+    // one scan over the table for all the given columns, rows outside the (inclusive, possibly partial) dates are ignored
+    static CyclicProfile build(const WeatherTable& table,
+        const vector<string>& columns,
+        Cycle cycle,
+        const string& startDate = "",
+        const string& endDate = "");
+    // every candle is one occurrence of the position of its timestamp (YYYY, YYYY-MM or YYYY-MM-DD)
+    static CyclicProfile ofCandles(const vector<Candlestick>& candlesticks, Cycle cycle, const string& column = "");
+
+    static int bucketCount(Cycle cycle);
+    static string bucketLabel(Cycle cycle, int bucket);
+    static int bucketOf(Cycle cycle, int stamp);
+    // 0 = Sunday (Sakamoto's method)
+    static int dayOfWeek(int year, int month, int day);
+
+    const vector<CycleBucket>& profile(const string& column) const; // throws invalid_argument if not built
+    void print(const string& column) const;
+
+    Cycle cycle = Cycle::MonthOfYear;
+    vector<string> columnNames;
+    vector<vector<CycleBucket>> buckets; // [column][bucket]
+};
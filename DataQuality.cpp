@@ -0,0 +1,134 @@
+#include "DataQuality.h"
+#include "WeatherTable.h"
+#include <bitset>
+#include <stdexcept>
+using namespace std;
+
+void GapBitmap::mark(long long hour) {
+    if (hour < firstHour) return; // rows before the start of the timeline are not tracked
+    extendTo(hour);
+    size_t offset = static_cast<size_t>(hour - firstHour);
+    bits[offset / 64] |= uint64_t(1) << (offset % 64);
+}
+
+void GapBitmap::extendTo(long long hour) {
+    if (hour < firstHour) return;
+    size_t offset = static_cast<size_t>(hour - firstHour);
+    if (offset >= numHours) {
+        numHours = offset + 1;
+        bits.resize((numHours + 63) / 64, 0);
+    }
+}
+
+bool GapBitmap::isValid(long long hour) const {
+    if (hour < firstHour || hour >= firstHour + static_cast<long long>(numHours)) return false;
+    size_t offset = static_cast<size_t>(hour - firstHour);
+    return (bits[offset / 64] >> (offset % 64)) & 1;
+}
+
+size_t GapBitmap::countValid() const {
+    size_t count = 0;
+    for (uint64_t word : bits) {
+        count += bitset<64>(word).count();
+    }
+    return count;
+}
+
+vector<pair<long long, long long>> GapBitmap::gaps() const {
+    vector<pair<long long, long long>> runs;
+    size_t offset = 0;
+    while (offset < numHours) {
+        // whole words of valid hours are skipped at once
+        if (offset % 64 == 0 && offset + 64 <= numHours && bits[offset / 64] == ~uint64_t(0)) {
+            offset += 64;
+            continue;
+        }
+        if ((bits[offset / 64] >> (offset % 64)) & 1) {
+            offset++;
+            continue;
+        }
+        size_t start = offset;
+        while (offset < numHours && !((bits[offset / 64] >> (offset % 64)) & 1)) {
+            offset++;
+        }
+        runs.emplace_back(firstHour + static_cast<long long>(start), static_cast<long long>(offset - start));
+    }
+    return runs;
+}
+
+bool DataQuality::isLeapYear(int year) {
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+int DataQuality::daysInMonth(int year, int month) {
+    static const int days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month < 1 || month > 12) return 0;
+    return (month == 2 && isLeapYear(year)) ? 29 : days[month - 1];
+}
+
+// civil date <-> day number conversions (proleptic gregorian calendar)
+long long DataQuality::hourOf(int stamp) {
+    long long y = WeatherTable::yearOf(stamp);
+    int m = WeatherTable::monthOf(stamp);
+    int d = WeatherTable::dayOf(stamp);
+    y -= m <= 2;
+    long long era = (y >= 0 ? y : y - 399) / 400;
+    long long yearOfEra = y - era * 400;
+    long long dayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    long long days = era * 146097 + dayOfEra - 719468;
+    return days * 24 + WeatherTable::hourOf(stamp);
+}
+
+int DataQuality::stampOf(long long hour) {
+    long long days = hour >= 0 ? hour / 24 : (hour - 23) / 24;
+    int hourOfDay = static_cast<int>(hour - days * 24);
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    long long dayOfEra = days - era * 146097;
+    long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    long long mp = (5 * dayOfYear + 2) / 153;
+    int day = static_cast<int>(dayOfYear - (153 * mp + 2) / 5 + 1);
+    int month = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    int year = static_cast<int>(yearOfEra + era * 400 + (month <= 2));
+    return ((year * 100 + month) * 100 + day) * 100 + hourOfDay;
+}
+
+long long DataQuality::nextPeriodHour(long long hour, bool monthly) {
+    int stamp = stampOf(hour);
+    int year = WeatherTable::yearOf(stamp);
+    int month = monthly ? WeatherTable::monthOf(stamp) + 1 : 13;
+    if (month > 12) {
+        year++;
+        month = 1;
+    }
+    return hourOf(((year * 100 + month) * 100 + 1) * 100);
+}
+
+size_t DataQuality::interpolateRun(long long lastHour, float lastReading, long long hour, float reading, int maxGapHours,
+    vector<float>& values) {
+    long long missing = hour - lastHour - 1;
+    if (missing < 1 || missing > maxGapHours) return 0;
+    float slope = (reading - lastReading) / static_cast<float>(hour - lastHour);
+    size_t count = static_cast<size_t>(missing);
+    values.resize(count);
+    float* out = values.data();
+    for (size_t i = 0; i < count; i++) {
+        out[i] = lastReading + slope * static_cast<float>(i + 1);
+    }
+    return count;
+}
+
+int DataQuality::hoursInPeriod(const string& group) {
+    try {
+        int year = stoi(group.substr(0, 4));
+        if (group.size() >= 7) {
+            return daysInMonth(year, stoi(group.substr(5, 2))) * 24;
+        }
+        return (isLeapYear(year) ? 366 : 365) * 24;
+    }
+    catch (const exception& e) {
+        return 0;
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+using namespace std;
+
+// one bit per hour of the timeline, set when the column has a valid reading for that hour
+// gaps (missing rows or unparseable values) are the unset bits
+struct GapBitmap {
+    long long firstHour = 0; // set by the owner before marking
+    size_t numHours = 0;
+    vector<uint64_t> bits;
+
+    void mark(long long hour);
+    void extendTo(long long hour); // grow the timeline without marking readings
+    bool isValid(long long hour) const;
+    size_t countValid() const;
+    size_t countMissing() const { return numHours - countValid(); }
+    // (first missing hour, length) of every run of missing hours
+    vector<pair<long long, long long>> gaps() const;
+};
+
+class DataQuality {
+public:
+    // hours since 1970-01-01T00 for a packed YYYYMMDDHH stamp, and back
+    static long long hourOf(int stamp);
+    static int stampOf(long long hour);
+    static bool isLeapYear(int year);
+    static int daysInMonth(int year, int month);
+    // expected hourly readings of a candlestick period (YYYY or YYYY-MM)
+    static int hoursInPeriod(const string& group);
+
+    // linear interpolation of the hours strictly between two valid readings, when at most maxGapHours are missing
+    // the whole run is written to values[0, missing) by a branch free loop; returns how many were filled
+    // shared by the streaming reader and the snapshot engine, so gap filling gives the same readings in both
+    static size_t interpolateRun(long long lastHour, float lastReading, long long hour, float reading, int maxGapHours,
+        vector<float>& values);
+    // first hour of the next year (or month) after the given hour
+    static long long nextPeriodHour(long long hour, bool monthly);
+    // splits count hours from firstHour into pieces within one year (or month)
+    // segment(stamp of the piece's first hour, offset, length) is called for each of them in order
+    template <typename Segment>
+    static void forEachPeriod(long long firstHour, size_t count, bool monthly, Segment segment) {
+        size_t offset = 0;
+        while (offset < count) {
+            long long hour = firstHour + static_cast<long long>(offset);
+            size_t length = min(count - offset, static_cast<size_t>(nextPeriodHour(hour, monthly) - hour));
+            segment(stampOf(hour), offset, length);
+            offset += length;
+        }
+    }
+};
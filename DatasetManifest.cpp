@@ -0,0 +1,195 @@
+#include "DatasetManifest.h"
+#include "Climatology.h"
+#include "Regions.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+const string DatasetManifest::manifestName = "manifest.csv";
+
+bool Partition::hasColumn(const string& column) const {
+    return find(columns.begin(), columns.end(), column) != columns.end();
+}
+
+bool DatasetManifest::isPartitioned(const string& path) {
+    ifstream manifest(path + "/" + manifestName);
+    return manifest.is_open();
+}
+
+string DatasetManifest::pathOf(const Partition& partition) const {
+    return directory + "/" + partition.file;
+}
+
+DatasetManifest DatasetManifest::load(const string& directory) {
+    ifstream file(directory + "/" + manifestName);
+    if (!file.is_open()) {
+        cerr << "Error: Could not open manifest in '" << directory << "'." << endl;
+        throw runtime_error("Manifest not found");
+    }
+
+    DatasetManifest manifest;
+    manifest.directory = directory;
+    string line;
+    getline(file, line); // skip manifest header
+    while (getline(file, line)) {
+        if (line.empty()) continue;
+        vector<string> tokens = CSVReader::tokenise(line, ',');
+        if (tokens.size() < 4) {
+            cerr << "Warning: Malformed manifest entry '" << line << "'. Skipping." << endl;
+            continue;
+        }
+        Partition partition;
+        partition.file = tokens[0];
+        partition.startDate = tokens[1];
+        partition.endDate = tokens[2];
+        partition.columns = CSVReader::tokenise(tokens[3], ';');
+        manifest.partitions.push_back(partition);
+    }
+
+    // partitions are always visited in date order so that groups spanning two files are merged
+    stable_sort(manifest.partitions.begin(), manifest.partitions.end(),
+        [](const Partition& a, const Partition& b) { return a.startDate < b.startDate; });
+    return manifest;
+}
+
+bool DatasetManifest::isAuxiliaryFile(const string& name) {
+    size_t slash = name.find_last_of("/\\");
+    string fileName = slash == string::npos ? name : name.substr(slash + 1);
+    return fileName == manifestName || fileName == RegionSet::configName || Climatology::isCacheFile(fileName);
+}
+
+DatasetManifest DatasetManifest::build(const string& directory, const vector<string>& files) {
+    DatasetManifest manifest;
+    manifest.directory = directory;
+
+    for (const string& name : files) {
+        if (isAuxiliaryFile(name)) {
+            cerr << "Warning: '" << name << "' is not a partition. Skipping." << endl;
+            continue;
+        }
+        ifstream file(directory + "/" + name);
+        if (!file.is_open()) {
+            cerr << "Warning: Could not open partition '" << name << "'. Skipping." << endl;
+            continue;
+        }
+        Partition partition;
+        partition.file = name;
+
+        string line;
+        if (!getline(file, line)) {
+            cerr << "Warning: Partition '" << name << "' is empty. Skipping." << endl;
+            continue;
+        }
+        partition.columns = CSVReader::tokenise(line, ',');
+
+        // date range is taken from the first and last rows (files are expected to be sorted by date)
+        string lastLine;
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            if (partition.startDate.empty()) partition.startDate = line.substr(0, 10);
+            lastLine = line;
+        }
+        if (lastLine.empty()) {
+            cerr << "Warning: Partition '" << name << "' has no rows. Skipping." << endl;
+            continue;
+        }
+        partition.endDate = lastLine.substr(0, 10);
+        manifest.partitions.push_back(partition);
+    }
+
+    stable_sort(manifest.partitions.begin(), manifest.partitions.end(),
+        [](const Partition& a, const Partition& b) { return a.startDate < b.startDate; });
+    manifest.save();
+    return manifest;
+}
+
+void DatasetManifest::save() const {
+    ofstream file(directory + "/" + manifestName);
+    if (!file.is_open()) {
+        cerr << "Error: Could not write manifest in '" << directory << "'." << endl;
+        throw runtime_error("Manifest not writable");
+    }
+    file << "file,startDate,endDate,columns" << '\n';
+    for (const Partition& partition : partitions) {
+        file << partition.file << "," << partition.startDate << "," << partition.endDate << ",";
+        for (size_t i = 0; i < partition.columns.size(); ++i) {
+            if (i > 0) file << ";";
+            file << partition.columns[i];
+        }
+        file << '\n';
+    }
+}
+
+vector<string> DatasetManifest::resolveFiles(const string& path,
+    const string& column,
+    Timeframe timeframe,
+    const string& year,
+    const string& startDate,
+    const string& endDate
+) {
+    if (!isPartitioned(path)) {
+        return { path };
+    }
+    DatasetManifest manifest = load(path);
+    vector<string> known = manifest.columns();
+    if (!column.empty() && find(known.begin(), known.end(), column) == known.end()) {
+        cerr << "Error: Country '" << column << "' not found in any partition." << endl;
+        throw invalid_argument("Country not found");
+    }
+    return manifest.selectPartitions(column, timeframe, year, startDate, endDate);
+}
+
+vector<string> DatasetManifest::selectPartitions(const string& column,
+    Timeframe timeframe,
+    const string& year,
+    const string& startDate,
+    const string& endDate
+) const {
+    // filters are applied to the date group (YYYY or YYYY-MM), so partitions are pruned on the same key
+    bool singleYear = timeframe == Timeframe::Monthly && year != "0";
+    size_t keyLength = singleYear ? 7 : 4;
+
+    vector<string> files;
+    for (const Partition& partition : partitions) {
+        if (!column.empty() && !partition.hasColumn(column)) continue;
+
+        string firstKey = partition.startDate.substr(0, keyLength);
+        string lastKey = partition.endDate.substr(0, keyLength);
+        if (singleYear && (lastKey.substr(0, 4) < year || firstKey.substr(0, 4) > year)) continue;
+        if (!startDate.empty() && lastKey < startDate) continue;
+        if (!endDate.empty() && firstKey > endDate) continue;
+
+        files.push_back(pathOf(partition));
+    }
+    return files;
+}
+
+vector<string> DatasetManifest::columns() const {
+    vector<string> all;
+    for (const Partition& partition : partitions) {
+        for (const string& column : partition.columns) {
+            if (find(all.begin(), all.end(), column) == all.end()) {
+                all.push_back(column);
+            }
+        }
+    }
+    return all;
+}
+
+vector<string> DatasetManifest::datasetColumns(const string& path) {
+    vector<string> all;
+    if (isPartitioned(path)) {
+        all = load(path).columns();
+    }
+    else {
+        ifstream file(path);
+        string line;
+        if (file.is_open() && getline(file, line)) {
+            all = CSVReader::tokenise(line, ',');
+        }
+    }
+    if (!all.empty()) all.erase(all.begin()); // first column holds the timestamp
+    return all;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "CsvReader.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+// one file of a partitioned dataset, with the date range and columns it covers
+struct Partition {
+    string file;
+    string startDate;
+    string endDate;
+    vector<string> columns;
+
+    bool hasColumn(const string& column) const;
+};
+
+// a directory of csv files sharing the same header schema, described by a manifest.csv file
+// manifest row format: file,startDate,endDate,column1;column2;...
+class DatasetManifest {
+public:
+    static const string manifestName;
+
+    // true if path is a directory holding a manifest, false for a plain csv file
+    static bool isPartitioned(const string& path);
+    static DatasetManifest load(const string& directory);
+    // scan the given partition files (relative to directory) and write their manifest
+    // files the app keeps next to the partitions (see isAuxiliaryFile) are skipped, so dir/*.csv can be passed
+    static DatasetManifest build(const string& directory, const vector<string>& files);
+    // manifest, regions config or climatology cache
+    static bool isAuxiliaryFile(const string& name);
+    void save() const;
+
+    // full paths of the files to open for a query, in date order (a plain csv resolves to itself)
+    // throws invalid_argument if no partition has the requested column
+    static vector<string> resolveFiles(const string& path,
+        const string& column,
+        Timeframe timeframe,
+        const string& year,
+        const string& startDate = "",
+        const string& endDate = "");
+    vector<string> selectPartitions(const string& column,
+        Timeframe timeframe,
+        const string& year,
+        const string& startDate = "",
+        const string& endDate = "") const;
+
+    // union of all partition columns, in first-seen order
+    vector<string> columns() const;
+    // temperature columns (timestamp excluded) of a csv file or partitioned directory
+    static vector<string> datasetColumns(const string& path);
+
+    string pathOf(const Partition& partition) const; // directory/file
+
+    string directory;
+    vector<Partition> partitions;
+};
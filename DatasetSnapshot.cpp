@@ -0,0 +1,380 @@
+#include "DatasetSnapshot.h"
+#include "DatasetManifest.h"
+#include "StreamingStats.h"
+#include "DataQuality.h"
+#include "Regions.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+#include <sys/stat.h>
+using namespace std;
+
+DatasetSnapshot::DatasetSnapshot(const string& path, long long version, long long modifiedTime, const string& regionsFingerprint,
+    const vector<string>& columnNames) :
+    path{ path },
+    version{ version },
+    modifiedTime{ modifiedTime },
+    regionsFingerprint{ regionsFingerprint },
+    columnNames{ columnNames } {}
+
+// modification time in seconds, 0 if the file does not exist
+static long long fileTime(const string& file) {
+    struct stat info;
+    return stat(file.c_str(), &info) == 0 ? static_cast<long long>(info.st_mtime) : 0;
+}
+
+shared_ptr<const DatasetSnapshot> DatasetSnapshot::load(const string& path, long long version, const DatasetSnapshot* previous) {
+    // taken before reading, so a change made while loading is seen by the next check
+    long long modifiedTime = modificationTime(path);
+    RegionSet regions = RegionSet::load(RegionSet::configPath(path));
+
+    DatasetManifest manifest;
+    vector<SourceFile> files;
+    if (DatasetManifest::isPartitioned(path)) {
+        manifest = DatasetManifest::load(path);
+        for (const Partition& partition : manifest.partitions) {
+            vector<string> columns(partition.columns.begin() + min<size_t>(1, partition.columns.size()), partition.columns.end());
+            files.push_back({ manifest.pathOf(partition), fileTime(manifest.pathOf(partition)), columns });
+        }
+    }
+    else {
+        ifstream file(path);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open the file '" << path << "'." << endl;
+            throw runtime_error("Could not open the file");
+        }
+        files.push_back({ path, fileTime(path), DatasetManifest::datasetColumns(path) });
+    }
+
+    vector<string> datasetColumns = DatasetManifest::datasetColumns(path);
+    // regions that can be computed from the dataset, the same ones loading every column adds
+    vector<string> columnNames = datasetColumns;
+    for (const Region& region : regions.regions) {
+        bool computable = find(datasetColumns.begin(), datasetColumns.end(), region.name) == datasetColumns.end();
+        for (const pair<string, float>& member : region.members) {
+            computable = computable && find(datasetColumns.begin(), datasetColumns.end(), member.first) != datasetColumns.end();
+        }
+        if (computable) columnNames.push_back(region.name);
+    }
+
+    shared_ptr<DatasetSnapshot> snapshot(new DatasetSnapshot(path, version, modifiedTime, regions.fingerprint(), columnNames));
+    snapshot->manifest = move(manifest);
+    snapshot->files = move(files);
+    snapshot->datasetColumns = move(datasetColumns);
+    snapshot->regions = move(regions);
+    snapshot->loaded.resize(snapshot->files.size());
+
+    // a reload only reads the partitions that changed, the others keep the columns already read
+    if (previous && previous->path == path) {
+        lock_guard<mutex> lock(previous->loadMutex);
+        for (size_t f = 0; f < snapshot->files.size(); f++) {
+            const SourceFile& file = snapshot->files[f];
+            for (size_t p = 0; p < previous->files.size(); p++) {
+                if (previous->files[p].path == file.path && previous->files[p].modifiedTime == file.modifiedTime && file.modifiedTime != 0) {
+                    snapshot->loaded[f] = previous->loaded[p];
+                }
+            }
+        }
+    }
+    return snapshot;
+}
+
+long long DatasetSnapshot::modificationTime(const string& path) {
+    vector<string> files = DatasetManifest::resolveFiles(path, "", Timeframe::Yearly, "0");
+    if (DatasetManifest::isPartitioned(path)) {
+        files.push_back(path + "/" + DatasetManifest::manifestName);
+    }
+    files.push_back(RegionSet::configPath(path));
+    long long newest = 0;
+    for (const string& file : files) {
+        newest = max(newest, fileTime(file));
+    }
+    return newest;
+}
+
+const DatasetSnapshot::LoadedColumn* DatasetSnapshot::LoadedFile::find(const string& name) const {
+    for (const LoadedColumn& column : columns) {
+        if (column.name == name) return &column;
+    }
+    return nullptr;
+}
+
+vector<size_t> DatasetSnapshot::filesFor(const vector<string>& columns, Timeframe timeframe, const string& year,
+    const string& startDate, const string& endDate) const
+{
+    if (manifest.directory.empty()) return { 0 }; // a single csv file
+    // same pruning as DatasetManifest::resolveFiles, one column at a time
+    vector<bool> selected(files.size(), false);
+    for (const string& column : columns) {
+        for (const string& file : manifest.selectPartitions(column, timeframe, year, startDate, endDate)) {
+            for (size_t f = 0; f < files.size(); f++) {
+                if (files[f].path == file) selected[f] = true;
+            }
+        }
+    }
+    vector<size_t> indices;
+    for (size_t f = 0; f < files.size(); f++) {
+        if (selected[f]) indices.push_back(f);
+    }
+    return indices;
+}
+
+vector<DatasetSnapshot::LoadedFile> DatasetSnapshot::read(const vector<size_t>& fileIndices, const vector<string>& columns) const {
+    vector<LoadedFile> result;
+    lock_guard<mutex> lock(loadMutex);
+    for (size_t f : fileIndices) {
+        const SourceFile& source = files[f];
+        LoadedFile& file = loaded[f];
+        vector<string> missing;
+        for (const string& column : columns) {
+            bool inFile = find(source.columns.begin(), source.columns.end(), column) != source.columns.end();
+            if (inFile && !file.find(column)) missing.push_back(column);
+        }
+        if (!missing.empty()) {
+            // a file changed after the snapshot was taken is read as it is now; the store publishes a newer
+            // snapshot once the change has settled, which reads it again
+            WeatherTable table = WeatherTable::loadColumns(source.path, missing, "", "");
+            if (file.stamps && *file.stamps != table.stamps) {
+                file = LoadedFile(); // rewritten since its other columns were read, they are read again when needed
+            }
+            if (!file.stamps) file.stamps = make_shared<const vector<int>>(move(table.stamps));
+            for (size_t c = 0; c < missing.size(); c++) {
+                file.columns.push_back({ missing[c], make_shared<const vector<float>>(move(table.columns[c])),
+                    make_shared<const GapBitmap>(move(table.validity[c])) });
+            }
+        }
+        if (file.stamps) result.push_back(file); // files without any of the columns add no rows
+    }
+    return result;
+}
+
+WeatherTable DatasetSnapshot::select(const vector<string>& selected, Timeframe timeframe, const string& year,
+    const string& startDate, const string& endDate, int firstStamp, int lastStamp) const
+{
+    return WeatherTable::withRegions(regions, datasetColumns, selected, [&](const vector<string>& requested) {
+        vector<string> columns = requested.empty() ? datasetColumns : requested;
+        for (const string& column : columns) {
+            if (find(datasetColumns.begin(), datasetColumns.end(), column) == datasetColumns.end()) {
+                cerr << "Error: Country '" << column << "' not found in the header." << endl;
+                throw invalid_argument("Country not found");
+            }
+        }
+        // the file pieces are copied outside the lock, so queries only wait for each other while files are read
+        vector<LoadedFile> parts = read(filesFor(columns, timeframe, year, startDate, endDate), columns);
+
+        WeatherTable table;
+        table.columnNames = columns;
+        table.columns.resize(columns.size());
+        table.validity.resize(columns.size());
+        for (const LoadedFile& part : parts) {
+            vector<const LoadedColumn*> sources;
+            for (const string& column : columns) sources.push_back(part.find(column));
+            const vector<int>& stamps = *part.stamps;
+            for (size_t r = 0; r < stamps.size(); r++) {
+                int stamp = stamps[r];
+                if (stamp < firstStamp || stamp > lastStamp) continue;
+                long long hour = DataQuality::hourOf(stamp);
+                if (table.stamps.empty()) {
+                    for (GapBitmap& bitmap : table.validity) {
+                        bitmap.firstHour = hour;
+                    }
+                }
+                table.stamps.push_back(stamp);
+                for (size_t c = 0; c < columns.size(); c++) {
+                    const LoadedColumn* source = sources[c];
+                    // columns a partition lacks are missing, like WeatherTable::load fills them
+                    table.columns[c].push_back(source ? (*source->values)[r] : WeatherTable::missing());
+                    if (source && source->validity->isValid(hour)) table.validity[c].mark(hour);
+                }
+            }
+        }
+        if (!table.stamps.empty()) {
+            long long lastHour = DataQuality::hourOf(table.stamps.back());
+            for (GapBitmap& bitmap : table.validity) {
+                bitmap.extendTo(lastHour);
+            }
+        }
+        return table;
+    });
+}
+
+WeatherTable DatasetSnapshot::table(const vector<string>& columns, const string& startDate, const string& endDate) const {
+    // partitions are pruned on the year only, rows are then filtered on the full timestamp
+    return select(columns, Timeframe::Yearly, "0", startDate.substr(0, 4), endDate.substr(0, 4),
+        WeatherTable::boundStamp(startDate, false), WeatherTable::boundStamp(endDate, true));
+}
+
+// date group (YYYY or YYYY-MM) of a packed stamp, with its filter result cached while the group is unchanged
+struct GroupOfStamp {
+    bool monthly;
+    const string& year;
+    const DataFilters& filters;
+
+    int key = -1;
+    string group;
+    bool inRange = false;
+
+    GroupOfStamp(bool monthly, const string& year, const DataFilters& filters) :
+        monthly{ monthly },
+        year{ year },
+        filters{ filters }
+    {
+    }
+
+    bool update(int stamp) {
+        int stampKey = monthly ? stamp / 10000 : WeatherTable::yearOf(stamp);
+        if (stampKey == key) return inRange;
+        key = stampKey;
+        char buffer[16];
+        if (monthly) {
+            snprintf(buffer, sizeof(buffer), "%04d-%02d", WeatherTable::yearOf(stamp), WeatherTable::monthOf(stamp));
+        }
+        else {
+            snprintf(buffer, sizeof(buffer), "%04d", WeatherTable::yearOf(stamp));
+        }
+        group = buffer;
+        inRange = (!monthly || group.compare(0, 4, year) == 0) && filters.isInDateRange(group);
+        return inRange;
+    }
+};
+
+vector<Candlestick> DatasetSnapshot::computeCandlesticks(const string& country,
+    Timeframe timeframe,
+    const string& year,
+    float minTemp,
+    float maxTemp,
+    const string& startDate,
+    const string& endDate,
+    bool extendedStats,
+    int maxGapFill
+) const {
+    // only the country (or the members of a region) from the partitions the legacy reader would open
+    WeatherTable table = select({ country }, timeframe, year, startDate, endDate,
+        numeric_limits<int>::min(), numeric_limits<int>::max());
+    const vector<float>& values = table.columns[0];
+    DataFilters filters{ minTemp, maxTemp, startDate, endDate };
+    // monthly without a year groups by year, exactly like the yearly timeframe
+    bool monthly = timeframe == Timeframe::Monthly && year != "0";
+
+    vector<Candlestick> candlesticks;
+    PeriodAccumulator period(extendedStats);
+    string currentGroup;
+    float previousClose = 0.0f;
+    bool firstGroup = true;
+
+    auto closeGroup = [&]() {
+        float close = period.close();
+        float open = firstGroup ? close : previousClose;
+        if (period.high <= filters.maxTemp && period.low >= filters.minTemp) {
+            candlesticks.push_back(period.toCandlestick(open, currentGroup));
+        }
+        period.reset();
+        previousClose = close;
+        firstGroup = false;
+    };
+    auto startGroup = [&](const string& group) {
+        if (group != currentGroup) {
+            if (!currentGroup.empty()) closeGroup();
+            currentGroup = group;
+        }
+    };
+
+    GroupOfStamp rowGroup{ monthly, year, filters };
+    GroupOfStamp gapGroup{ monthly, year, filters };
+    bool hasLastReading = false;
+    long long lastHour = 0;
+    float lastReading = 0.0f;
+    vector<float> gapValues;
+
+    for (size_t r = 0; r < values.size(); r++) {
+        float temperature = values[r];
+        if (WeatherTable::isMissing(temperature)) continue;
+        int stamp = table.stamps[r];
+        if (!rowGroup.update(stamp)) continue;
+
+        if (maxGapFill > 0) {
+            // the hours between the last valid reading and this one, interpolated as one run
+            // and added a period at a time
+            long long hour = DataQuality::hourOf(stamp);
+            if (hasLastReading) {
+                size_t filled = DataQuality::interpolateRun(lastHour, lastReading, hour, temperature, maxGapFill, gapValues);
+                DataQuality::forEachPeriod(lastHour + 1, filled, monthly, [&](int gapStamp, size_t offset, size_t length) {
+                    if (!gapGroup.update(gapStamp)) return;
+                    startGroup(gapGroup.group);
+                    period.addFilled(gapValues.data() + offset, length);
+                });
+            }
+            hasLastReading = true;
+            lastHour = hour;
+            lastReading = temperature;
+        }
+        startGroup(rowGroup.group);
+        period.add(temperature);
+    }
+    if (period.tempCount > 0) {
+        closeGroup();
+    }
+    return candlesticks;
+}
+
+DatasetStore::DatasetStore(const string& path) :
+    datasetPath{ path },
+    snapshot{ DatasetSnapshot::load(path) }
+{
+    pendingTime = snapshot->modifiedTime;
+}
+
+DatasetStore::~DatasetStore() {
+    stopWatching();
+}
+
+shared_ptr<const DatasetSnapshot> DatasetStore::current() const {
+    return atomic_load(&snapshot);
+}
+
+bool DatasetStore::reloadIfChanged() {
+    lock_guard<mutex> lock(reloadMutex);
+    shared_ptr<const DatasetSnapshot> active = current();
+    try {
+        // the source may be removed or replaced while it is checked, which must not end the watcher thread
+        long long modifiedTime = DatasetSnapshot::modificationTime(datasetPath);
+        bool settled = modifiedTime == pendingTime;
+        pendingTime = modifiedTime;
+        if (modifiedTime == active->modifiedTime || !settled) return false;
+
+        // built while readers keep using the active snapshot, then published with a single pointer swap
+        shared_ptr<const DatasetSnapshot> reloaded = DatasetSnapshot::load(datasetPath, active->version + 1, active.get());
+        atomic_store(&snapshot, reloaded);
+    }
+    catch (const exception& e) {
+        cerr << "Warning: Reloading '" << datasetPath << "' failed, keeping the loaded data." << endl;
+        return false;
+    }
+    return true;
+}
+
+void DatasetStore::watch(int intervalSeconds) {
+    stopWatching();
+    stopping = false;
+    watcher = thread([this, intervalSeconds]() {
+        unique_lock<mutex> lock(watchMutex);
+        while (!wakeUp.wait_for(lock, chrono::seconds(intervalSeconds), [this]() { return stopping; })) {
+            lock.unlock();
+            reloadIfChanged();
+            lock.lock();
+        }
+    });
+}
+
+void DatasetStore::stopWatching() {
+    if (!watcher.joinable()) return;
+    {
+        lock_guard<mutex> lock(watchMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    watcher.join();
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "WeatherTable.h"
+#include "Candlestick.h"
+#include "CsvReader.h"
+#include "DatasetManifest.h"
+#include "Regions.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+// the dataset as it was when the snapshot was taken; shared by reference count so any number of
+// threads can query it, and it stays alive until the last query using it is done
+// columns are read on first use, per partition and per column, only from the partitions a query selects, and kept
+// for later queries: opening a dataset reads the manifest only, and memory grows with the columns and years queried
+class DatasetSnapshot {
+public:
+    // partitions whose file is unchanged since the previous snapshot share its columns instead of being read again
+    static shared_ptr<const DatasetSnapshot> load(const string& path, long long version = 1,
+        const DatasetSnapshot* previous = nullptr);
+
+    const string path;
+    const long long version;      // increases with every reload
+    const long long modifiedTime; // newest modification time of the source files when loading started
+    const string regionsFingerprint; // RegionSet::fingerprint of the region definitions read when loading
+    const vector<string> columnNames; // dataset columns, then the regions defined on them
+
+    // selected columns and regions (all when empty) for the rows between two inclusive YYYY[-MM[-DD]] bounds
+    // throws invalid_argument if a name is neither a dataset column nor a region
+    WeatherTable table(const vector<string>& columns = {}, const string& startDate = "", const string& endDate = "") const;
+
+    // same candlesticks as CSVReader::computeCandlesticks, from the same partitions, computed in memory
+    // throws invalid_argument if the country is not in the dataset
+    vector<Candlestick> computeCandlesticks(const string& country,
+        Timeframe timeframe,
+        const string& year = "0",
+        float minTemp = numeric_limits<float>::lowest(),
+        float maxTemp = numeric_limits<float>::max(),
+        const string& startDate = "",
+        const string& endDate = "",
+        bool extendedStats = false,
+        int maxGapFill = 0) const;
+
+    // newest modification time (seconds) of a csv file, or of a partitioned directory's manifest and partitions,
+    // and of the regions config, so a changed region definition is reloaded as well
+    static long long modificationTime(const string& path);
+
+private:
+    DatasetSnapshot(const string& path, long long version, long long modifiedTime, const string& regionsFingerprint,
+        const vector<string>& columnNames);
+
+    // one csv file of the dataset (the file itself when it is not partitioned)
+    struct SourceFile {
+        string path;
+        long long modifiedTime = 0;
+        vector<string> columns; // from the manifest, or the header
+    };
+    // columns read so far from one file; the vectors are never changed once read, so they can be
+    // handed to queries and to later snapshots without copying
+    struct LoadedColumn {
+        string name;
+        shared_ptr<const vector<float>> values;
+        shared_ptr<const GapBitmap> validity;
+    };
+    struct LoadedFile {
+        shared_ptr<const vector<int>> stamps;
+        vector<LoadedColumn> columns;
+
+        const LoadedColumn* find(const string& name) const;
+    };
+
+    DatasetManifest manifest; // empty for a single csv file
+    vector<SourceFile> files; // in date order
+    vector<string> datasetColumns;
+    RegionSet regions;
+    mutable mutex loadMutex; // one reader of the files at a time
+    mutable vector<LoadedFile> loaded; // per file, guarded by loadMutex
+
+    // files the legacy reader would open for these columns and filters
+    vector<size_t> filesFor(const vector<string>& columns, Timeframe timeframe, const string& year,
+        const string& startDate, const string& endDate) const;
+    // reads the columns the files do not have yet and returns what queries need of them
+    vector<LoadedFile> read(const vector<size_t>& fileIndices, const vector<string>& columns) const;
+    // rows of the files between two packed stamps, regions computed from their members
+    WeatherTable select(const vector<string>& columns, Timeframe timeframe, const string& year,
+        const string& startDate, const string& endDate, int firstStamp, int lastStamp) const;
+};
+
+// holds the current snapshot of a dataset and swaps in a new one when the source changes
+// readers take current() and keep that snapshot for the whole query, so a reload never blocks them;
+// a reload is cheap, it reads the manifest and keeps the columns of every partition that did not change
+class DatasetStore {
+public:
+    explicit DatasetStore(const string& path); // loads the first snapshot, throws like WeatherTable::load
+    ~DatasetStore();
+
+    shared_ptr<const DatasetSnapshot> current() const;
+    // reload if the source changed and has not been modified since the previous check,
+    // so a file still being written is not picked up; returns true if a new snapshot was published
+    bool reloadIfChanged();
+    // check for changes every intervalSeconds on a background thread
+    void watch(int intervalSeconds);
+    void stopWatching();
+
+    const string& path() const { return datasetPath; }
+
+private:
+    string datasetPath;
+    shared_ptr<const DatasetSnapshot> snapshot; // only accessed through atomic_load/atomic_store
+    long long pendingTime = 0; // modification time seen by the last check, waiting to settle
+
+    mutex reloadMutex; // one reload at a time
+    thread watcher;
+    mutex watchMutex;
+    condition_variable wakeUp;
+    bool stopping = false;
+};
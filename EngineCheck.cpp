@@ -0,0 +1,536 @@
+#include "EngineCheck.h"
+#include "DatasetSnapshot.h"
+#include "DatasetManifest.h"
+#include "OutOfCoreAggregator.h"
+#include "CandlesticksCollection.h"
+#include "CorrelationAnalysis.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+using namespace std;
+
+const vector<string> EngineCheck::engines = { "legacy", "snapshot", "out-of-core", "out-of-core-spill" };
+
+string EngineQuery::describe() const {
+    ostringstream text;
+    text << country << " " << CandlesticksCollection::timeframeToString(timeframe);
+    if (year != "0") text << " " << year;
+    if (minTemp != numeric_limits<float>::lowest() || maxTemp != numeric_limits<float>::max()) {
+        text << " temp " << minTemp << ".." << maxTemp;
+    }
+    if (!startDate.empty() || !endDate.empty()) text << " dates " << startDate << ".." << endDate;
+    if (extendedStats) text << " extended";
+    if (maxGapFill > 0) text << " gap fill " << maxGapFill << "h";
+    return text.str();
+}
+
+// engine warnings about skipped lines would drown the report, so cerr is muted while they run
+struct QuietErrors {
+    streambuf* saved;
+    QuietErrors() : saved{ cerr.rdbuf(nullptr) } {}
+    ~QuietErrors() { cerr.rdbuf(saved); }
+};
+
+static bool supports(const string& engine, const EngineQuery& query) {
+    return query.maxGapFill == 0 || engine == "legacy" || engine == "snapshot";
+}
+
+EngineCheck::EngineCheck(const EngineCheckOptions& options) :
+    options{ options } {}
+
+vector<EngineQuery> EngineCheck::queriesFor(const vector<string>& countries, int year) {
+    string y = to_string(year);
+    string next = to_string(year + 1);
+    vector<EngineQuery> queries;
+    for (const string& country : countries) {
+        EngineQuery yearly;
+        yearly.country = country;
+        EngineQuery monthly = yearly;
+        monthly.timeframe = Timeframe::Monthly;
+        monthly.year = y;
+
+        queries.push_back(yearly);
+        queries.push_back(monthly);
+
+        EngineQuery query = yearly;
+        query.extendedStats = true;
+        queries.push_back(query);
+        query = monthly;
+        query.extendedStats = true;
+        queries.push_back(query);
+
+        query = monthly; // monthly without a year groups by year
+        query.year = "0";
+        queries.push_back(query);
+
+        query = yearly;
+        query.minTemp = -5.0f;
+        query.maxTemp = 25.0f;
+        queries.push_back(query);
+        query = monthly;
+        query.minTemp = 0.0f;
+        queries.push_back(query);
+
+        query = yearly;
+        query.startDate = y;
+        query.endDate = next;
+        queries.push_back(query);
+        query = monthly;
+        query.startDate = y + "-02";
+        query.endDate = y + "-11";
+        queries.push_back(query);
+        query = monthly; // a full date as bound is compared with the YYYY-MM group key
+        query.startDate = y + "-02-29";
+        query.endDate = y + "-12-31";
+        queries.push_back(query);
+
+        query = yearly;
+        query.maxGapFill = 6;
+        queries.push_back(query);
+        query = monthly;
+        query.maxGapFill = 6;
+        query.extendedStats = true;
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+static bool withinTolerance(double expected, double actual, double tolerance) {
+    if (std::isnan(expected) || std::isnan(actual)) return std::isnan(expected) && std::isnan(actual);
+    return fabs(expected - actual) <= tolerance * max(1.0, fabs(expected));
+}
+
+string EngineCheck::compare(const vector<Candlestick>& expected, const vector<Candlestick>& actual, double tolerance) {
+    ostringstream difference;
+    difference << setprecision(9);
+    if (expected.size() != actual.size()) {
+        difference << expected.size() << " candles expected, got " << actual.size();
+        return difference.str();
+    }
+    for (size_t i = 0; i < expected.size(); i++) {
+        const Candlestick& e = expected[i];
+        const Candlestick& a = actual[i];
+        if (e.timestamp != a.timestamp) {
+            difference << "candle " << i << " is " << a.timestamp << " instead of " << e.timestamp;
+            return difference.str();
+        }
+        const char* names[] = { "open", "high", "low", "close", "coverage", "stddev", "p10", "median", "p90" };
+        double values[2][9];
+        const Candlestick* candles[2] = { &e, &a };
+        for (int c = 0; c < 2; c++) {
+            const Candlestick& cs = *candles[c];
+            double stats[4] = { cs.stats.stddev, cs.stats.p10, cs.stats.median, cs.stats.p90 };
+            double row[9] = { cs.open, cs.high, cs.low, cs.close, cs.coverage, stats[0], stats[1], stats[2], stats[3] };
+            copy(row, row + 9, values[c]);
+        }
+        if (e.stats.available != a.stats.available) {
+            difference << e.timestamp << " extended statistics " << (e.stats.available ? "missing" : "unexpected");
+            return difference.str();
+        }
+        int numValues = e.stats.available ? 9 : 5;
+        for (int v = 0; v < numValues; v++) {
+            if (!withinTolerance(values[0][v], values[1][v], tolerance)) {
+                difference << e.timestamp << " " << names[v] << " " << values[1][v] << " instead of " << values[0][v];
+                return difference.str();
+            }
+        }
+    }
+    return "";
+}
+
+vector<vector<Candlestick>> EngineCheck::runEngine(const string& engine, const string& path, const vector<EngineQuery>& queries) const {
+    vector<vector<Candlestick>> results(queries.size());
+    QuietErrors quiet;
+    if (engine == "legacy") {
+        for (size_t q = 0; q < queries.size(); q++) {
+            const EngineQuery& query = queries[q];
+            results[q] = CSVReader::computeCandlesticks(path, query.country, query.timeframe, query.year, query.minTemp,
+                query.maxTemp, query.startDate, query.endDate, query.extendedStats, query.maxGapFill);
+        }
+    }
+    else if (engine == "snapshot") {
+        // one load serves every query, which is how the menu uses it
+        shared_ptr<const DatasetSnapshot> snapshot = DatasetSnapshot::load(path);
+        for (size_t q = 0; q < queries.size(); q++) {
+            const EngineQuery& query = queries[q];
+            results[q] = snapshot->computeCandlesticks(query.country, query.timeframe, query.year, query.minTemp,
+                query.maxTemp, query.startDate, query.endDate, query.extendedStats, query.maxGapFill);
+        }
+    }
+    else {
+        for (size_t q = 0; q < queries.size(); q++) {
+            const EngineQuery& query = queries[q];
+            if (!supports(engine, query)) continue;
+            OutOfCoreOptions outOfCore;
+            outOfCore.spillDirectory = options.workDirectory;
+            if (engine == "out-of-core-spill") {
+                // room for two date groups, so runs are spilled and merged on every input
+                outOfCore.memoryCap = 2 * OutOfCoreAggregator(outOfCore).groupBytes(1, query.extendedStats);
+                outOfCore.maxOpenRuns = 4; // and merged in several passes
+            }
+            OutOfCoreAggregator aggregator(outOfCore);
+            results[q] = aggregator.computeCandlesticks(path, { query.country }, query.timeframe, query.year, query.minTemp,
+                query.maxTemp, query.startDate, query.endDate, query.extendedStats)[query.country];
+        }
+    }
+    return results;
+}
+
+// year in the middle of a dataset, so monthly queries have data on both sides
+static int middleYear(const string& path) {
+    QuietErrors quiet;
+    shared_ptr<const DatasetSnapshot> snapshot = DatasetSnapshot::load(path);
+    if (snapshot->columnNames.empty()) return 2000;
+    vector<int> stamps = snapshot->table({ snapshot->columnNames.front() }).stamps;
+    if (stamps.empty()) return 2000;
+    return (WeatherTable::yearOf(stamps.front()) + WeatherTable::yearOf(stamps.back())) / 2;
+}
+
+bool EngineCheck::checkInput(const string& path, const string& referencePath, const vector<string>& countries, int year) const {
+    vector<EngineQuery> queries = queriesFor(countries, year);
+    vector<vector<Candlestick>> expected = runEngine("legacy", referencePath, queries);
+
+    bool equivalent = true;
+    cout << path << " (" << queries.size() << " queries";
+    if (referencePath != path) cout << ", reference " << referencePath;
+    cout << ")" << endl;
+    for (size_t e = 1; e < engines.size(); e++) {
+        vector<vector<Candlestick>> actual = runEngine(engines[e], path, queries);
+        size_t mismatches = 0;
+        string firstMismatch;
+        for (size_t q = 0; q < queries.size(); q++) {
+            if (!supports(engines[e], queries[q])) continue;
+            string difference = compare(expected[q], actual[q], options.tolerance);
+            if (difference.empty()) continue;
+            if (mismatches++ == 0) firstMismatch = queries[q].describe() + ": " + difference;
+        }
+        cout << "  " << left << setw(20) << engines[e] << right;
+        if (mismatches == 0) {
+            cout << "ok" << endl;
+            continue;
+        }
+        cout << "MISMATCH in " << mismatches << " queries, first: " << firstMismatch << endl;
+        equivalent = false;
+    }
+    return equivalent;
+}
+
+static string timestampOf(int year, int month, int day, int hour) {
+    char text[32];
+    snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:00:00Z", year, month, day, hour);
+    return text;
+}
+
+// smooth made-up readings between about -10 and 30 degrees
+static string reading(int month, int day, int hour, int column) {
+    char text[16];
+    snprintf(text, sizeof(text), "%.3f", 10.0 - 12.0 * cos((month - 1) * 0.52) + 4.0 * sin(hour * 0.26) + (day % 7) * 0.4 - column * 1.5);
+    return text;
+}
+
+// hourly rows from the first to the last day (inclusive) of a year, row text chosen by the callback
+static void writeHours(ofstream& out, int year, int firstMonth, int firstDay, int lastMonth, int lastDay,
+    const function<string(int month, int day, int hour, int row)>& row)
+{
+    static const int daysInMonth[12] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int index = 0;
+    for (int month = firstMonth; month <= lastMonth; month++) {
+        int days = (month == 2 && !leap) ? 28 : daysInMonth[month - 1];
+        for (int day = (month == firstMonth ? firstDay : 1); day <= (month == lastMonth ? lastDay : days); day++) {
+            for (int hour = 0; hour < 24; hour++) {
+                string text = row(month, day, hour, index++);
+                if (!text.empty()) out << text << "\n";
+            }
+        }
+    }
+}
+
+vector<EngineEdgeCase> EngineCheck::writeEdgeCases() const {
+    const string header = "utc_timestamp,AA_temperature,BB_temperature\n";
+    auto normal = [](int year, int month, int day, int hour) {
+        return timestampOf(year, month, day, hour) + "," + reading(month, day, hour, 0) + "," + reading(month, day, hour, 1);
+    };
+    vector<EngineEdgeCase> cases;
+    auto write = [&](const string& name, const function<void(ofstream&)>& rows) {
+        string path = options.workDirectory + "/engine_check_" + name + ".csv";
+        ofstream out(path);
+        if (!out.is_open()) {
+            cerr << "Error: Could not create edge case file '" << path << "'." << endl;
+            return string();
+        }
+        out << header;
+        rows(out);
+        return path;
+    };
+    auto create = [&](const string& name, const function<void(ofstream&)>& rows) {
+        string path = write(name, rows);
+        if (!path.empty()) cases.push_back({ path, path });
+    };
+
+    // short rows, trailing separators, extra fields, text and non-finite values, blank lines and windows line endings
+    create("malformed", [&](ofstream& out) {
+        writeHours(out, 2000, 1, 1, 3, 31, [&](int month, int day, int hour, int row) {
+            string stamp = timestampOf(2000, month, day, hour);
+            switch (row % 37) {
+            case 3: return stamp + "," + reading(month, day, hour, 0);
+            case 7: return stamp + "," + reading(month, day, hour, 0) + ",";
+            case 11: return normal(2000, month, day, hour) + ",99.0";
+            case 13: return stamp + ",n/a," + reading(month, day, hour, 1);
+            case 17: return stamp + "," + reading(month, day, hour, 0) + ",--";
+            case 19: return string("\n") + normal(2000, month, day, hour);
+            case 23: return normal(2000, month, day, hour) + "\r";
+            case 29: return stamp + ",nan,-inf";
+            case 31: return stamp + "," + reading(month, day, hour, 0) + ",1e50";
+            default: return normal(2000, month, day, hour);
+            }
+        });
+    });
+
+    // empty fields: a whole month of one column, short gaps gap filling can bridge, rows with no reading at all
+    create("missing", [&](ofstream& out) {
+        writeHours(out, 2000, 1, 1, 4, 30, [&](int month, int day, int hour, int row) {
+            string stamp = timestampOf(2000, month, day, hour);
+            string a = reading(month, day, hour, 0);
+            string b = reading(month, day, hour, 1);
+            if (month == 2) a = "";
+            if (row % 50 < 3) a = "";
+            if (row % 2 == 1) b = "";
+            if (month == 3 && day >= 10 && day <= 12) a = b = "";
+            return stamp + "," + a + "," + b;
+        });
+    });
+
+    // years and months holding a single reading
+    create("single_rows", [&](ofstream& out) {
+        out << normal(1990, 6, 15, 12) << "\n" << normal(1991, 1, 1, 0) << "\n" << normal(1995, 12, 31, 23) << "\n";
+        out << normal(2000, 1, 20, 5) << "\n";
+        writeHours(out, 2000, 2, 1, 2, 1, [&](int month, int day, int hour, int) {
+            return normal(2000, month, day, hour);
+        });
+        out << normal(2000, 3, 31, 23) << "\n" << normal(2000, 12, 1, 0) << "\n" << normal(2007, 7, 7, 7) << "\n";
+    });
+
+    // readings on both sides of year, month and leap day boundaries
+    create("boundaries", [&](ofstream& out) {
+        auto hours = [&](int year, int month, int day, int firstHour, int lastHour) {
+            for (int hour = firstHour; hour <= lastHour; hour++) out << normal(year, month, day, hour) << "\n";
+        };
+        hours(1999, 12, 31, 20, 23);
+        hours(2000, 1, 1, 0, 3);
+        hours(2000, 1, 31, 23, 23);
+        hours(2000, 2, 1, 0, 0);
+        hours(2000, 2, 28, 22, 23);
+        hours(2000, 2, 29, 0, 23);
+        hours(2000, 3, 1, 0, 1);
+        hours(2000, 12, 31, 22, 23);
+        hours(2001, 1, 1, 0, 1);
+    });
+
+    // timestamps that are no existing date and hour (month 13, hour 99, February 30 and 31, April 31), one of them
+    // inside a gap; the table engines drop these rows while the legacy reader still groups them by their text,
+    // so the reference is the legacy reader on the same rows without them
+    auto invalidStamps = [&](bool withInvalid) {
+        return [&, withInvalid](ofstream& out) {
+            writeHours(out, 2000, 1, 1, 4, 30, [&](int month, int day, int hour, int) {
+                string row = normal(2000, month, day, hour);
+                if (month == 3 && day == 5 && hour >= 10 && hour <= 13) row = ""; // a gap gap filling can bridge
+                if (!withInvalid) return row;
+                if (month == 1 && day == 31 && hour == 23) row += "\n" + normal(2000, 13, 1, 5);
+                if (month == 2 && day == 11 && hour == 12) row += "\n" + normal(2000, 2, 11, 99);
+                if (month == 2 && day == 29 && hour == 23) {
+                    row += "\n" + normal(2000, 2, 30, 0) + "\n" + normal(2000, 2, 31, 5);
+                }
+                if (month == 3 && day == 5 && hour == 11) row = normal(2000, 3, 5, 99);
+                if (month == 3 && day == 20 && hour == 6) row += "\n" + normal(2000, 13, 20, 6);
+                if (month == 4 && day == 30 && hour == 23) row += "\n" + normal(2000, 4, 31, 0);
+                return row;
+            });
+        };
+    };
+    string invalid = write("invalid_stamps", invalidStamps(true));
+    string reference = write("invalid_stamps_reference", invalidStamps(false));
+    if (!invalid.empty() && !reference.empty()) cases.push_back({ invalid, reference });
+    return cases;
+}
+
+static bool reportCheck(const string& name, bool passed, const string& detail) {
+    cout << "  " << left << setw(20) << name << right << (passed ? "ok" : "FAILED: " + detail) << endl;
+    return passed;
+}
+
+// one row per year from 1980, a column per series
+static WeatherTable yearlyTable(const vector<string>& names, const vector<vector<float>>& series) {
+    WeatherTable table;
+    for (size_t t = 0; t < series[0].size(); t++) {
+        table.stamps.push_back((1980 + static_cast<int>(t)) * 1000000 + 70100);
+    }
+    table.columnNames = names;
+    table.columns = series;
+    table.validity.resize(names.size());
+    return table;
+}
+
+bool EngineCheck::checkAnalyses() {
+    bool passed = true;
+
+    // B is A one year later, both with a missing year: at lag 1 the overlapping pairs are identical
+    vector<float> a, b;
+    for (int t = 0; t < 40; t++) {
+        a.push_back(static_cast<float>(8.0 + 3.0 * sin(t * 0.9) + 0.05 * t * t));
+    }
+    a[10] = WeatherTable::missing();
+    b.push_back(WeatherTable::missing());
+    b.insert(b.end(), a.begin(), a.end() - 1);
+    CorrelationResult lagged = CorrelationAnalysis::compute(yearlyTable({ "A", "B" }, { a, b }), Timeframe::Yearly, 1);
+    ostringstream detail;
+    detail << setprecision(17) << "corr(A, B) at lag 1 is " << lagged.at(0, 1) << ", expected 1";
+    passed = reportCheck("lagged correlation", fabs(lagged.at(0, 1) - 1.0) < 1e-12, detail.str()) && passed;
+
+    // the same with a year missing from the table altogether: the lag still shifts by calendar years
+    WeatherTable withoutYear = yearlyTable({ "A", "B" }, { a, b });
+    withoutYear.stamps.erase(withoutYear.stamps.begin() + 20);
+    for (vector<float>& column : withoutYear.columns) {
+        column.erase(column.begin() + 20);
+    }
+    CorrelationResult calendar = CorrelationAnalysis::compute(withoutYear, Timeframe::Yearly, 1);
+    detail.str("");
+    detail << "corr(A, B) at lag 1 is " << calendar.at(0, 1) << ", expected 1";
+    passed = reportCheck("lag over a gap", fabs(calendar.at(0, 1) - 1.0) < 1e-12, detail.str()) && passed;
+
+    return passed;
+}
+
+vector<EngineTiming> EngineCheck::timeEngines(const string& path, const vector<EngineQuery>& queries) const {
+    vector<EngineTiming> timings;
+    for (const string& engine : engines) {
+        EngineTiming timing{ engine, numeric_limits<double>::max() };
+        for (int r = 0; r < max(options.repetitions, 1); r++) {
+            auto start = chrono::steady_clock::now();
+            runEngine(engine, path, queries);
+            chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            timing.seconds = min(timing.seconds, elapsed.count());
+        }
+        timings.push_back(timing);
+    }
+    return timings;
+}
+
+vector<EngineTiming> EngineCheck::loadBaseline(const string& path) {
+    vector<EngineTiming> timings;
+    ifstream file(path);
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        vector<string> tokens = CSVReader::tokenise(line, ',');
+        if (tokens.size() < 2) continue;
+        try {
+            timings.push_back({ tokens[0], stod(tokens[1]) });
+        }
+        catch (const exception& e) {
+            cerr << "Warning: Invalid baseline line '" << line << "' skipped." << endl;
+        }
+    }
+    return timings;
+}
+
+bool EngineCheck::saveBaseline(const string& path, const vector<EngineTiming>& timings) {
+    ofstream file(path);
+    if (!file.is_open()) {
+        cerr << "Error: Could not write baseline file '" << path << "'." << endl;
+        return false;
+    }
+    file << "# engine,seconds (fastest run over the check queries)" << endl;
+    file << setprecision(6);
+    for (const EngineTiming& timing : timings) {
+        file << timing.engine << "," << timing.seconds << endl;
+    }
+    return true;
+}
+
+bool EngineCheck::run(const string& datasetPath, const vector<string>& countries, const string& baselinePath) {
+    vector<string> known = DatasetManifest::datasetColumns(datasetPath);
+    for (const string& country : countries) {
+        if (find(known.begin(), known.end(), country) == known.end()) {
+            cerr << "Error: Country '" << country << "' not found in the header." << endl;
+            return false;
+        }
+    }
+
+    cout << "Comparing engines with CSVReader::computeCandlesticks (tolerance " << options.tolerance << ")" << endl << endl;
+    bool equivalent;
+    vector<EngineEdgeCase> edgeCases = writeEdgeCases();
+    try {
+        equivalent = checkInput(datasetPath, datasetPath, countries, middleYear(datasetPath));
+        for (const EngineEdgeCase& edgeCase : edgeCases) { // all edge cases are built around 2000
+            equivalent = checkInput(edgeCase.path, edgeCase.referencePath, { "AA_temperature", "BB_temperature" }, 2000)
+                && equivalent;
+        }
+    }
+    catch (const exception& e) {
+        cerr << "Error: Engine failed during the check: " << e.what() << endl;
+        equivalent = false;
+    }
+    for (const EngineEdgeCase& edgeCase : edgeCases) {
+        remove(edgeCase.path.c_str());
+        if (edgeCase.referencePath != edgeCase.path) remove(edgeCase.referencePath.c_str());
+    }
+    if (edgeCases.size() < 5) equivalent = false; // an edge case file could not be written
+
+    cout << "Analysis checks" << endl;
+    equivalent = checkAnalyses() && equivalent;
+
+    vector<EngineQuery> queries = queriesFor(countries, middleYear(datasetPath));
+    vector<EngineTiming> timings = timeEngines(datasetPath, queries);
+    vector<EngineTiming> baseline = loadBaseline(baselinePath);
+
+    bool fast = true;
+    cout << endl << "Engine timings on " << datasetPath << " (fastest of " << options.repetitions << " runs, "
+        << queries.size() << " queries)" << endl << endl;
+    // the engines are judged relative to the legacy reader timed in the same run, so a slower or busier
+    // machine does not count as a regression; the legacy reader itself is only reported
+    auto timingOf = [](const vector<EngineTiming>& list, const string& engine) {
+        auto found = find_if(list.begin(), list.end(), [&](const EngineTiming& t) { return t.engine == engine; });
+        return found == list.end() ? 0.0 : found->seconds;
+    };
+    double legacyNow = timingOf(timings, "legacy");
+    double legacyBaseline = timingOf(baseline, "legacy");
+    cout << fixed << setprecision(3);
+    for (const EngineTiming& timing : timings) {
+        cout << "  " << left << setw(20) << timing.engine << right << timing.seconds << "s";
+        double baselineSeconds = timingOf(baseline, timing.engine);
+        if (baselineSeconds <= 0.0) {
+            cout << endl;
+            continue;
+        }
+        cout << "\tbaseline " << baselineSeconds << "s";
+        if (timing.engine != "legacy" && legacyBaseline > 0.0) {
+            double limit = baselineSeconds / legacyBaseline * legacyNow * (1.0 + options.allowedSlowdown) + options.timingSlack;
+            cout << "\tlimit " << limit << "s";
+            if (timing.seconds > limit) {
+                cout << "\tREGRESSION";
+                fast = false;
+            }
+        }
+        cout << endl;
+    }
+    cout.unsetf(ios::floatfield);
+    cout << setprecision(6);
+
+    if (baseline.empty()) {
+        if (!equivalent) {
+            cout << endl << "Baseline not written, the engines do not agree." << endl;
+        }
+        else if (saveBaseline(baselinePath, timings)) {
+            cout << endl << "Baseline written to " << baselinePath << "." << endl;
+        }
+    }
+    cout << endl << (equivalent && fast ? "Engine check passed." : "Engine check FAILED.") << endl;
+    return equivalent && fast;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "CsvReader.h"
+#include "Candlestick.h"
+#include <vector>
+#include <string>
+#include <limits>
+using namespace std;
+
+// one candlestick query, run the same way by every engine
+struct EngineQuery {
+    string country;
+    Timeframe timeframe = Timeframe::Yearly;
+    string year = "0";
+    float minTemp = numeric_limits<float>::lowest();
+    float maxTemp = numeric_limits<float>::max();
+    string startDate = "";
+    string endDate = "";
+    bool extendedStats = false;
+    int maxGapFill = 0; // the out-of-core engine does not fill gaps and skips these queries
+
+    string describe() const;
+};
+
+struct EngineCheckOptions {
+    double tolerance = 1e-4;       // largest accepted difference between candle values, relative above 1
+    double allowedSlowdown = 0.5;  // fraction an engine may be slower than its baseline, relative to the legacy reader
+    double timingSlack = 0.05;     // seconds of timer noise always allowed on top
+    int repetitions = 3;           // timed runs per engine, the fastest one counts
+    string workDirectory = ".";    // generated edge case files and spill runs
+};
+
+// timing of one engine over all queries on the dataset
+struct EngineTiming {
+    string engine;
+    double seconds = 0.0;
+};
+
+// generated input file; the legacy reader runs on referencePath, which only differs from path when the file
+// has rows the legacy reader reads differently by design
+struct EngineEdgeCase {
+    string path;
+    string referencePath;
+};
+
+// differential check of the candlestick engines: CSVReader::computeCandlesticks is the reference and the
+// snapshot and out-of-core engines (with and without spilling) must give the same candles, within tolerance,
+// for the dataset and for generated edge case files (malformed rows, missing values, single-row groups,
+// boundary dates, invalid timestamps), and the table based analyses must give known answers; the engines are then timed on the dataset and compared with a stored baseline,
+// scaled by how fast the legacy reader ran this time
+class EngineCheck {
+public:
+    explicit EngineCheck(const EngineCheckOptions& options = EngineCheckOptions());
+
+    // returns false if an engine disagrees with the reference or got slower than its baseline
+    // a missing baseline file is written from this run's timings (only when all engines agree)
+    bool run(const string& datasetPath, const vector<string>& countries, const string& baselinePath);
+
+    static const vector<string> engines;
+
+    // queries covering both timeframes, extended statistics, temperature and date filters and gap filling
+    static vector<EngineQuery> queriesFor(const vector<string>& countries, int year);
+    // first difference between two candle series, empty if they agree
+    static string compare(const vector<Candlestick>& expected, const vector<Candlestick>& actual, double tolerance);
+
+    // analyses built on the in-memory table, checked against inputs with a known answer; reports each one
+    static bool checkAnalyses();
+
+    static vector<EngineTiming> loadBaseline(const string& path); // empty if there is no baseline file
+    static bool saveBaseline(const string& path, const vector<EngineTiming>& timings);
+
+private:
+    EngineCheckOptions options;
+
+    // edge case files written to the work directory, removed again after the check
+    vector<EngineEdgeCase> writeEdgeCases() const;
+    // candles of one engine for every query (an empty result for the queries it does not support)
+    vector<vector<Candlestick>> runEngine(const string& engine, const string& path, const vector<EngineQuery>& queries) const;
+    // monthly queries use year, the legacy reader reads referencePath
+    bool checkInput(const string& path, const string& referencePath, const vector<string>& countries, int year) const;
+    vector<EngineTiming> timeEngines(const string& path, const vector<EngineQuery>& queries) const;
+};
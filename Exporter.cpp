@@ -0,0 +1,323 @@
+#include "Exporter.h"
+#include <iostream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+// output file written through a large buffer, so the disk sees a few big writes instead of one per value
+class BufferedWriter {
+public:
+    explicit BufferedWriter(const string& path, size_t capacity = 1u << 20) :
+        file{ fopen(path.c_str(), "wb") },
+        buffer(capacity) {}
+    ~BufferedWriter() { close(); }
+
+    bool isOpen() const { return file != nullptr; }
+
+    void write(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        if (size >= buffer.size()) { // big blocks (whole columns) bypass the buffer
+            flush();
+            if (file && fwrite(bytes, 1, size, file) != size) failed = true;
+            return;
+        }
+        while (size > 0) {
+            if (used == buffer.size()) flush();
+            size_t chunk = min(size, buffer.size() - used);
+            memcpy(buffer.data() + used, bytes, chunk);
+            used += chunk;
+            bytes += chunk;
+            size -= chunk;
+        }
+    }
+    void write(const string& text) { write(text.data(), text.size()); }
+    void write(const char* text) { write(text, strlen(text)); }
+    // shortest %g form that reads back as the same value, 6-9 digits for a float, 15-17 for a double
+    void number(double value, bool isFloat) {
+        char text[32];
+        int length = 0;
+        for (int digits = isFloat ? 6 : 15; digits <= (isFloat ? 9 : 17); digits++) {
+            length = snprintf(text, sizeof(text), "%.*g", digits, value);
+            if (isFloat ? strtof(text, nullptr) == static_cast<float>(value) : strtod(text, nullptr) == value) break;
+        }
+        write(text, static_cast<size_t>(length));
+    }
+    template <typename T>
+    void value(T value) { write(&value, sizeof(value)); }
+    void pad(size_t bytes) {
+        static const char zeros[8] = {};
+        write(zeros, bytes);
+    }
+
+    void flush() {
+        if (file && used > 0 && fwrite(buffer.data(), 1, used, file) != used) failed = true;
+        used = 0;
+    }
+    bool close() {
+        if (!file) return !failed;
+        flush();
+        if (fclose(file) != 0) failed = true;
+        file = nullptr;
+        return !failed;
+    }
+
+private:
+    FILE* file;
+    vector<char> buffer;
+    size_t used = 0;
+    bool failed = false;
+};
+
+static const size_t columnNameLength = 32;
+enum BinaryType : uint32_t { Int32 = 0, Float32 = 1, Float64 = 2 };
+
+struct BinaryColumn {
+    string name;
+    BinaryType type;
+    size_t width() const { return type == Float64 ? 8 : 4; }
+};
+
+static size_t alignTo8(size_t offset) {
+    return (offset + 7) / 8 * 8;
+}
+
+// header, strings and column directory; returns the offset of each column's data, position is left after the header
+static vector<uint64_t> writeBinaryHeader(BufferedWriter& out, const vector<BinaryColumn>& columns,
+    const vector<string>& strings, uint64_t numRows, uint64_t& position)
+{
+    size_t offset = 8 + 4 + 4 + 8;
+    for (const string& text : strings) offset += 4 + text.size();
+    offset += columns.size() * (columnNameLength + 4 + 4 + 8);
+    position = offset;
+    vector<uint64_t> offsets;
+    for (const BinaryColumn& column : columns) {
+        offset = alignTo8(offset);
+        offsets.push_back(offset);
+        offset += column.width() * numRows;
+    }
+
+    out.write("WXCOLS01", 8);
+    out.value(static_cast<uint32_t>(columns.size()));
+    out.value(static_cast<uint32_t>(strings.size()));
+    out.value(numRows);
+    for (const string& text : strings) {
+        out.value(static_cast<uint32_t>(text.size()));
+        out.write(text);
+    }
+    for (size_t c = 0; c < columns.size(); c++) {
+        // names are NUL padded; callers reject names that do not fit
+        char name[columnNameLength] = {};
+        memcpy(name, columns[c].name.c_str(), min(columns[c].name.size(), columnNameLength - 1));
+        out.write(name, columnNameLength);
+        out.value(static_cast<uint32_t>(columns[c].type));
+        out.value(static_cast<uint32_t>(0));
+        out.value(offsets[c]);
+    }
+    return offsets;
+}
+
+// padding from the end of the previous column to the start of the next one
+static void padTo(BufferedWriter& out, uint64_t& position, uint64_t offset) {
+    out.pad(static_cast<size_t>(offset - position));
+    position = offset;
+}
+
+static string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// csv field as in RFC 4180: quoted, with quotes doubled, when it holds a separator, quote or line break
+static string csvField(const string& text) {
+    if (text.find_first_of(",\"\r\n") == string::npos) return text;
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// csv leaves missing values empty, ndjson writes null
+static void writeValue(BufferedWriter& out, double value, bool isFloat, ExportFormat format) {
+    if (std::isnan(value)) {
+        if (format == ExportFormat::Ndjson) out.write("null");
+        return;
+    }
+    out.number(value, isFloat);
+}
+
+// packed stamp of the start of a YYYY, YYYY-MM or YYYY-MM-DD period, -1 if unreadable
+static int periodStamp(const string& timestamp) {
+    string date = timestamp;
+    if (date.size() == 4) date += "-01";
+    if (date.size() == 7) date += "-01";
+    return WeatherTable::packStamp(date.c_str(), date.size());
+}
+
+static string isoTimestamp(int stamp) {
+    char text[32];
+    snprintf(text, sizeof(text), "%sT%02d:00:00Z", WeatherTable::dateOf(stamp).c_str(), WeatherTable::hourOf(stamp));
+    return text;
+}
+
+bool Exporter::parseFormat(const string& name, ExportFormat& format) {
+    if (name == "csv") format = ExportFormat::Csv;
+    else if (name == "ndjson") format = ExportFormat::Ndjson;
+    else if (name == "binary") format = ExportFormat::Binary;
+    else return false;
+    return true;
+}
+
+bool Exporter::exportCandlesticks(const string& path, ExportFormat format, const vector<CandleSeries>& series) {
+    BufferedWriter out(path);
+    if (!out.isOpen()) {
+        cerr << "Error: Could not create export file '" << path << "'." << endl;
+        return false;
+    }
+    // open/high/low/close come from float aggregates, coverage and the distribution are doubles
+    const double none = numeric_limits<double>::quiet_NaN();
+
+    if (format == ExportFormat::Csv) {
+        out.write("country,period,timestamp,open,high,low,close,coverage,stddev,p10,median,p90\n");
+    }
+    if (format != ExportFormat::Binary) {
+        static const char* fieldNames[] = { "open", "high", "low", "close", "coverage", "stddev", "p10", "median", "p90" };
+        for (const CandleSeries& s : series) {
+            for (const Candlestick& cs : s.candlesticks) {
+                double values[9] = { cs.open, cs.high, cs.low, cs.close, cs.coverage,
+                    cs.stats.available ? cs.stats.stddev : none, cs.stats.available ? cs.stats.p10 : none,
+                    cs.stats.available ? cs.stats.median : none, cs.stats.available ? cs.stats.p90 : none };
+                if (format == ExportFormat::Csv) {
+                    out.write(csvField(s.country) + "," + csvField(s.period) + "," + csvField(cs.timestamp));
+                    for (int v = 0; v < 9; v++) {
+                        out.write(",", 1);
+                        writeValue(out, values[v], v < 4, format);
+                    }
+                }
+                else {
+                    out.write("{\"country\":" + jsonString(s.country) + ",\"period\":" + jsonString(s.period) +
+                        ",\"timestamp\":" + jsonString(cs.timestamp));
+                    for (int v = 0; v < 9; v++) {
+                        out.write(",\"");
+                        out.write(fieldNames[v]);
+                        out.write("\":");
+                        writeValue(out, values[v], v < 4, format);
+                    }
+                    out.write("}", 1);
+                }
+                out.write("\n", 1);
+            }
+        }
+        return out.close();
+    }
+
+    // binary: one row per candle, the series column indexes the "country/period" strings
+    vector<string> names;
+    uint64_t numRows = 0;
+    for (const CandleSeries& s : series) {
+        names.push_back(s.country + "/" + s.period);
+        numRows += s.candlesticks.size();
+    }
+    vector<BinaryColumn> columns = { { "series", Int32 }, { "period_start", Int32 },
+        { "open", Float64 }, { "high", Float64 }, { "low", Float64 }, { "close", Float64 }, { "coverage", Float64 },
+        { "stddev", Float64 }, { "p10", Float64 }, { "median", Float64 }, { "p90", Float64 } };
+    uint64_t position;
+    vector<uint64_t> offsets = writeBinaryHeader(out, columns, names, numRows, position);
+
+    for (size_t c = 0; c < columns.size(); c++) {
+        padTo(out, position, offsets[c]);
+        for (size_t s = 0; s < series.size(); s++) {
+            for (const Candlestick& cs : series[s].candlesticks) {
+                const CandleStats& stats = cs.stats;
+                switch (c) {
+                case 0: out.value(static_cast<int32_t>(s)); break;
+                case 1: out.value(static_cast<int32_t>(periodStamp(cs.timestamp))); break;
+                case 2: out.value(cs.open); break;
+                case 3: out.value(cs.high); break;
+                case 4: out.value(cs.low); break;
+                case 5: out.value(cs.close); break;
+                case 6: out.value(cs.coverage); break;
+                case 7: out.value(stats.available ? stats.stddev : none); break;
+                case 8: out.value(stats.available ? stats.p10 : none); break;
+                case 9: out.value(stats.available ? stats.median : none); break;
+                default: out.value(stats.available ? stats.p90 : none); break;
+                }
+            }
+        }
+        position += columns[c].width() * numRows;
+    }
+    return out.close();
+}
+
+bool Exporter::exportColumns(const string& path, ExportFormat format, const WeatherTable& table, const vector<string>& names) {
+    vector<const vector<float>*> data;
+    for (const string& name : names) {
+        if (table.columnIndex(name) == -1) {
+            cerr << "Error: Country '" << name << "' not found in the header." << endl;
+            return false;
+        }
+        // refused before the file is created, a truncated name could clash with another column
+        if (format == ExportFormat::Binary && name.size() >= columnNameLength) {
+            cerr << "Error: Column name '" << name << "' is longer than " << columnNameLength - 1
+                << " characters, which the binary format cannot store." << endl;
+            return false;
+        }
+        data.push_back(&table.column(name));
+    }
+    BufferedWriter out(path);
+    if (!out.isOpen()) {
+        cerr << "Error: Could not create export file '" << path << "'." << endl;
+        return false;
+    }
+
+    if (format == ExportFormat::Csv) {
+        out.write("utc_timestamp");
+        for (const string& name : names) out.write("," + csvField(name));
+        out.write("\n", 1);
+        for (size_t r = 0; r < table.numRows(); r++) {
+            out.write(isoTimestamp(table.stamps[r]));
+            for (const vector<float>* column : data) {
+                out.write(",", 1);
+                writeValue(out, (*column)[r], true, format);
+            }
+            out.write("\n", 1);
+        }
+        return out.close();
+    }
+    if (format == ExportFormat::Ndjson) {
+        vector<string> keys;
+        for (const string& name : names) keys.push_back("," + jsonString(name) + ":");
+        for (size_t r = 0; r < table.numRows(); r++) {
+            out.write("{\"utc_timestamp\":\"" + isoTimestamp(table.stamps[r]) + "\"");
+            for (size_t c = 0; c < data.size(); c++) {
+                out.write(keys[c]);
+                writeValue(out, (*data[c])[r], true, format);
+            }
+            out.write("}\n", 2);
+        }
+        return out.close();
+    }
+
+    // binary: the columns are already contiguous in memory, so each one is a single write
+    vector<BinaryColumn> columns = { { "stamp", Int32 } };
+    for (const string& name : names) columns.push_back({ name, Float32 });
+    uint64_t numRows = table.numRows();
+    uint64_t position;
+    vector<uint64_t> offsets = writeBinaryHeader(out, columns, {}, numRows, position);
+    for (size_t c = 0; c < columns.size(); c++) {
+        padTo(out, position, offsets[c]);
+        if (c == 0) out.write(table.stamps.data(), sizeof(int) * numRows);
+        else out.write(data[c - 1]->data(), sizeof(float) * numRows);
+        position += columns[c].width() * numRows;
+    }
+    return out.close();
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "Candlestick.h"
+#include "CsvReader.h"
+#include "WeatherTable.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+enum class ExportFormat { Csv, Ndjson, Binary };
+
+// one exported candlestick series, e.g. AT_temperature / Monthly 1985
+struct CandleSeries {
+    string country;
+    string period; // "Yearly" or "Monthly YYYY"
+    vector<Candlestick> candlesticks;
+};
+
+// writes candlestick series and raw columns at full precision through a large output buffer
+//
+// csv and ndjson hold one row / object per candle (series columns first) or per reading, with each number
+// in the shortest form that reads back exactly (as a float for readings and open/high/low/close)
+// csv names holding a separator, quote or line break are quoted as in RFC 4180
+// the binary format is columnar and meant to be memory mapped, all values in host byte order:
+//   "WXCOLS01", uint32 column count, uint32 string count, uint64 row count,
+//   strings (uint32 length + bytes, the series names referenced by the series column),
+//   column directory (char name[32] NUL padded, names of 32+ characters are refused, uint32 type 0=int32 1=float32 2=float64, uint32 0, uint64 file offset),
+//   then each column's values contiguously from its 8-byte aligned offset
+// missing values are NaN (null in ndjson)
+class Exporter {
+public:
+    static bool parseFormat(const string& name, ExportFormat& format); // csv, ndjson or binary
+
+    // returns false (after reporting) if the output cannot be written
+    static bool exportCandlesticks(const string& path, ExportFormat format, const vector<CandleSeries>& series);
+    // packed YYYYMMDDHH stamp and one column per name (raw readings, NaN when missing)
+    static bool exportColumns(const string& path, ExportFormat format, const WeatherTable& table, const vector<string>& columns);
+};
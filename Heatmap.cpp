@@ -0,0 +1,174 @@
+#include "Heatmap.h"
+#include "Climatology.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+using namespace std;
+
+static const char* monthNames[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+Heatmap Heatmap::build(const WeatherTable& table,
+    const string& column,
+    HeatmapColumns columns,
+    HeatmapStat stat,
+    const string& startDate,
+    const string& endDate,
+    int daysPerCell
+) {
+    const vector<float>& data = table.column(column);
+    int firstStamp = WeatherTable::boundStamp(startDate, false);
+    int lastStamp = WeatherTable::boundStamp(endDate, true);
+
+    Heatmap heatmap;
+    heatmap.column = column;
+    heatmap.columns = columns;
+    heatmap.stat = stat;
+    heatmap.daysPerCell = columns == HeatmapColumns::Months ? 1 : max(daysPerCell, 1);
+    heatmap.numCols = columns == HeatmapColumns::Months ? 12 :
+        (Climatology::daysPerYear + heatmap.daysPerCell - 1) / heatmap.daysPerCell;
+
+    // year range of the selected rows sizes the dense accumulator
+    int minYear = numeric_limits<int>::max(), maxYear = numeric_limits<int>::min();
+    for (int stamp : table.stamps) {
+        if (stamp < firstStamp || stamp > lastStamp) continue;
+        minYear = min(minYear, WeatherTable::yearOf(stamp));
+        maxYear = max(maxYear, WeatherTable::yearOf(stamp));
+    }
+    if (minYear > maxYear) return heatmap;
+    heatmap.firstYear = minYear;
+    heatmap.numYears = maxYear - minYear + 1;
+
+    size_t cells = static_cast<size_t>(heatmap.numYears) * heatmap.numCols;
+    vector<double> sum(cells, 0.0);
+    vector<float> highest(cells, numeric_limits<float>::lowest());
+    vector<int> count(cells, 0);
+
+    // the binning pass: every reading lands in exactly one cell
+    for (size_t r = 0; r < data.size(); r++) {
+        int stamp = table.stamps[r];
+        float value = data[r];
+        if (stamp < firstStamp || stamp > lastStamp || WeatherTable::isMissing(value)) continue;
+        int col = columns == HeatmapColumns::Months ? WeatherTable::monthOf(stamp) - 1 :
+            Climatology::dayIndex(WeatherTable::monthOf(stamp), WeatherTable::dayOf(stamp)) / heatmap.daysPerCell;
+        if (col < 0 || col >= heatmap.numCols) continue;
+        size_t cell = static_cast<size_t>(WeatherTable::yearOf(stamp) - minYear) * heatmap.numCols + col;
+        sum[cell] += value;
+        highest[cell] = max(highest[cell], value);
+        count[cell]++;
+    }
+
+    heatmap.values.assign(cells, WeatherTable::missing());
+    heatmap.minValue = numeric_limits<float>::max();
+    heatmap.maxValue = numeric_limits<float>::lowest();
+    for (size_t cell = 0; cell < cells; cell++) {
+        if (count[cell] == 0) continue;
+        float value = stat == HeatmapStat::Mean ? static_cast<float>(sum[cell] / count[cell]) : highest[cell];
+        heatmap.values[cell] = value;
+        heatmap.minValue = min(heatmap.minValue, value);
+        heatmap.maxValue = max(heatmap.maxValue, value);
+    }
+    return heatmap;
+}
+
+bool Heatmap::supportsTrueColor() {
+    const char* colorTerm = getenv("COLORTERM");
+    return colorTerm && (strcmp(colorTerm, "truecolor") == 0 || strcmp(colorTerm, "24bit") == 0);
+}
+
+// diverging blue -> pale yellow -> red scale, t in [0, 1]
+static void colorOf(double t, int& red, int& green, int& blue) {
+    static const int stops[5][3] = { { 49, 54, 149 }, { 116, 173, 209 }, { 255, 255, 191 }, { 244, 109, 67 }, { 165, 0, 38 } };
+    t = min(max(t, 0.0), 1.0) * 4;
+    int stop = min(static_cast<int>(t), 3);
+    double blend = t - stop;
+    red = static_cast<int>(stops[stop][0] + (stops[stop + 1][0] - stops[stop][0]) * blend);
+    green = static_cast<int>(stops[stop][1] + (stops[stop + 1][1] - stops[stop][1]) * blend);
+    blue = static_cast<int>(stops[stop][2] + (stops[stop + 1][2] - stops[stop][2]) * blend);
+}
+
+// background color escape, truecolor or nearest entry of the 6x6x6 color cube
+static void appendBackground(string& out, double t, bool trueColor) {
+    int red, green, blue;
+    colorOf(t, red, green, blue);
+    char escape[32];
+    if (trueColor) {
+        snprintf(escape, sizeof(escape), "\033[48;2;%d;%d;%dm", red, green, blue);
+    }
+    else {
+        int index = 16 + 36 * ((red * 5 + 127) / 255) + 6 * ((green * 5 + 127) / 255) + (blue * 5 + 127) / 255;
+        snprintf(escape, sizeof(escape), "\033[48;5;%dm", index);
+    }
+    out += escape;
+}
+
+string Heatmap::render(bool trueColor) const {
+    string out;
+    if (numYears == 0) {
+        out = "No data to plot.\n";
+        return out;
+    }
+    int cellWidth = columns == HeatmapColumns::Months ? 3 : 1;
+    double range = maxValue > minValue ? maxValue - minValue : 1.0;
+    // escape plus cell text per cell, with room for labels
+    out.reserve(static_cast<size_t>(numYears + 4) * (numCols * (20 + cellWidth) + 16));
+
+    out += (stat == HeatmapStat::Mean ? "Mean" : "Max");
+    out += " temperature for " + column + ":\n\n     ";
+    // header: month names, or a month initial above the first cell of each month
+    if (columns == HeatmapColumns::Months) {
+        for (int col = 0; col < numCols; col++) {
+            out += monthNames[col];
+        }
+    }
+    else {
+        string header(numCols, ' ');
+        for (int month = 1; month <= 12; month++) {
+            header[Climatology::dayIndex(month, 1) / daysPerCell] = monthNames[month - 1][0];
+        }
+        out += header;
+    }
+    out += '\n';
+
+    char label[16];
+    for (int y = 0; y < numYears; y++) {
+        snprintf(label, sizeof(label), "%04d ", firstYear + y);
+        out += label;
+        for (int col = 0; col < numCols; col++) {
+            float value = at(y, col);
+            if (WeatherTable::isMissing(value)) {
+                out.append(cellWidth, ' ');
+                continue;
+            }
+            appendBackground(out, (value - minValue) / range, trueColor);
+            out.append(cellWidth, ' ');
+            out += "\033[0m";
+        }
+        out += '\n';
+    }
+
+    // color scale
+    snprintf(label, sizeof(label), "%.1f", minValue);
+    out += "\n     ";
+    out += label;
+    out += ' ';
+    for (int step = 0; step < 24; step++) {
+        appendBackground(out, step / 23.0, trueColor);
+        out += " \033[0m";
+    }
+    snprintf(label, sizeof(label), " %.1f", maxValue);
+    out += label;
+    if (columns == HeatmapColumns::DaysOfYear) {
+        out += "  (" + to_string(daysPerCell) + " days per cell)";
+    }
+    out += '\n';
+    return out;
+}
+
+void Heatmap::print() const {
+    string out = render(supportsTrueColor());
+    cout.write(out.data(), out.size());
+    cout.flush();
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "WeatherTable.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+enum class HeatmapColumns { Months, DaysOfYear };
+enum class HeatmapStat { Mean, Max };
+
+// years down, months (or groups of days of the year) across, each cell colored by its mean or max temperature
+class Heatmap {
+public:
+    // single pass binning the column's hourly readings into a dense year x column accumulator
+    // startDate/endDate are inclusive (possibly partial) dates, empty for no bound
+    static Heatmap build(const WeatherTable& table,
+        const string& column,
+        HeatmapColumns columns,
+        HeatmapStat stat,
+        const string& startDate = "",
+        const string& endDate = "",
+        int daysPerCell = 4);
+
+    // whole chart as one string of ANSI colored cells, truecolor or the 256 color palette
+    string render(bool trueColor) const;
+    // render and emit with a single write
+    void print() const;
+    // true if the terminal advertises 24 bit color (COLORTERM)
+    static bool supportsTrueColor();
+
+    string column;
+    HeatmapColumns columns = HeatmapColumns::Months;
+    HeatmapStat stat = HeatmapStat::Mean;
+    int daysPerCell = 1;
+    int firstYear = 0;
+    int numYears = 0;
+    int numCols = 0;
+    vector<float> values; // [year][column], NaN where there are no readings
+    float minValue = 0.0f;
+    float maxValue = 0.0f;
+
+    float at(int yearIndex, int col) const { return values[yearIndex * numCols + col]; }
+};
@@ -0,0 +1,355 @@
+#include "InteractiveChart.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#ifdef _WIN32
+#include <windows.h>
+#include <conio.h>
+#include <io.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#endif
+using namespace std;
+
+enum Key { KeyNone = 0, KeyEscape = 27, KeyLeft = 1000, KeyRight, KeyUp, KeyDown, KeyEnd = -1 };
+
+// unchanged cells shorter than a cursor move are rewritten instead of skipped
+static const int maxGapToRewrite = 6;
+// smallest frame laid out (status, plot and labels); a smaller terminal just shows its top left corner
+static const int minScreenRows = 8;
+static const int minScreenCols = 20;
+// bytes of an escape sequence arrive together, a lone ESC press is followed by nothing
+static const int escapeTimeoutMs = 50;
+
+// raw keyboard input and alternate screen for the lifetime of the chart
+struct RawTerminal {
+#ifdef _WIN32
+    RawTerminal() {
+        cout << "\033[?1049h\033[?25l" << flush;
+    }
+#else
+    termios original;
+    RawTerminal() {
+        tcgetattr(STDIN_FILENO, &original);
+        termios raw = original;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+        cout << "\033[?1049h\033[?25l" << flush;
+    }
+#endif
+    ~RawTerminal() {
+        cout << "\033[0m\033[?25h\033[?1049l" << flush;
+#ifndef _WIN32
+        tcsetattr(STDIN_FILENO, TCSANOW, &original);
+#endif
+    }
+};
+
+static bool isInteractiveTerminal() {
+#ifdef _WIN32
+    return _isatty(_fileno(stdin)) && _isatty(_fileno(stdout));
+#else
+    return isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+#endif
+}
+
+static void terminalSize(int& rows, int& cols) {
+    rows = 24;
+    cols = 80;
+#ifdef _WIN32
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(GetStdHandle(STD_OUTPUT_HANDLE), &info)) {
+        cols = info.srWindow.Right - info.srWindow.Left + 1;
+        rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        rows = size.ws_row;
+        cols = size.ws_col;
+    }
+#endif
+    rows = max(rows, minScreenRows);
+    cols = max(cols, minScreenCols);
+}
+
+#ifndef _WIN32
+// next input byte if one arrives within the timeout
+static bool readByteWithin(char& c, int milliseconds) {
+    pollfd input{ STDIN_FILENO, POLLIN, 0 };
+    return poll(&input, 1, milliseconds) > 0 && read(STDIN_FILENO, &c, 1) == 1;
+}
+#endif
+
+static int readKey() {
+#ifdef _WIN32
+    int c = _getch();
+    if (c == 0 || c == 224) {
+        switch (_getch()) {
+        case 75: return KeyLeft;
+        case 77: return KeyRight;
+        case 72: return KeyUp;
+        case 80: return KeyDown;
+        default: return KeyNone;
+        }
+    }
+    return c;
+#else
+    char c;
+    if (read(STDIN_FILENO, &c, 1) != 1) return KeyEnd;
+    if (c != '\033') return c;
+    // arrow keys arrive as ESC [ A..D, ESC on its own is a key press of its own
+    char sequence[2];
+    if (!readByteWithin(sequence[0], escapeTimeoutMs)) return KeyEscape;
+    if (!readByteWithin(sequence[1], escapeTimeoutMs)) return KeyNone;
+    if (sequence[0] != '[') return KeyNone;
+    switch (sequence[1]) {
+    case 'D': return KeyLeft;
+    case 'C': return KeyRight;
+    case 'A': return KeyUp;
+    case 'B': return KeyDown;
+    default: return KeyNone;
+    }
+#endif
+}
+
+InteractiveChart::InteractiveChart(shared_ptr<const DatasetSnapshot> snapshot,
+    string country,
+    float minTemp,
+    float maxTemp,
+    string startDate,
+    string endDate
+) :
+    snapshot{ snapshot },
+    countries{ snapshot->columnNames },
+    countryIndex{ 0 },
+    timeframe{ Timeframe::Yearly },
+    year{ "0" },
+    minTemp{ minTemp },
+    maxTemp{ maxTemp },
+    startDate{ startDate },
+    endDate{ endDate },
+    firstVisible{ 0 },
+    visibleCount{ 0 },
+    screenRows{ 24 },
+    screenCols{ 80 },
+    bytesSent{ 0 }
+{
+    auto found = find(countries.begin(), countries.end(), country);
+    if (found == countries.end()) {
+        countries.insert(countries.begin(), country);
+        found = countries.begin();
+    }
+    countryIndex = found - countries.begin();
+    terminalSize(screenRows, screenCols);
+    reload();
+    // start zoomed out on the most recent periods
+    visibleCount = maxVisible();
+    size_t total = collection.getCandlesticks().size();
+    firstVisible = total > visibleCount ? total - visibleCount : 0;
+}
+
+void InteractiveChart::reload() {
+    collection = CandlesticksCollection(*snapshot, countries[countryIndex], timeframe, year,
+        minTemp, maxTemp, startDate, endDate);
+}
+
+size_t InteractiveChart::maxVisible() const {
+    int colsPerCandle = (timeframe == Timeframe::Yearly) ? 5 : 8;
+    return static_cast<size_t>(max(1, (screenCols - 4 - 2) / colsPerCandle));
+}
+
+void InteractiveChart::clampView() {
+    size_t total = collection.getCandlesticks().size();
+    visibleCount = max<size_t>(1, min(visibleCount, maxVisible()));
+    if (firstVisible + visibleCount > total) {
+        firstVisible = total > visibleCount ? total - visibleCount : 0;
+    }
+}
+
+vector<string> InteractiveChart::renderFrame() {
+    vector<string> frame(screenRows * screenCols, " ");
+    auto write = [&](int row, int col, const string& text) {
+        if (row >= screenRows) return;
+        for (size_t i = 0; i < text.size() && col + (int)i < screenCols; i++) {
+            frame[row * screenCols + col + i] = string(1, text[i]);
+        }
+    };
+
+    const vector<Candlestick>& candlesticks = collection.getCandlesticks();
+    size_t lastVisible = min(candlesticks.size(), firstVisible + visibleCount);
+
+    stringstream status;
+    status << countries[countryIndex] << " | " << CandlesticksCollection::timeframeToString(timeframe);
+    if (timeframe == Timeframe::Monthly) status << " " << year;
+    status << " | " << (candlesticks.empty() ? 0 : firstVisible + 1) << "-" << lastVisible << " of " << candlesticks.size()
+        << " | arrows pan, +/- zoom, c/C country, t timeframe, q quit | " << bytesSent << " bytes";
+    write(0, 0, status.str());
+
+    if (candlesticks.empty()) {
+        write(2, 0, "No candlesticks to plot.");
+        return frame;
+    }
+
+    vector<Candlestick> visible(candlesticks.begin() + firstVisible, candlesticks.begin() + lastVisible);
+    CandlesticksCollection view = collection.withCandlesticks(visible);
+
+    // vertical scale chosen so the visible candles fill the rows left after status and x labels
+    int plotRows = max(3, screenRows - 3);
+    float padding = 1.0f;
+    double low = visible[0].low, high = visible[0].high;
+    for (const Candlestick& cs : visible) {
+        low = min(low, cs.low);
+        high = max(high, cs.high);
+    }
+    float degPerRow = static_cast<float>(max(0.1, (high - low + 2 * padding) / (plotRows - 1)));
+
+    PlotData pd = view.initializePlotData(degPerRow, padding);
+    view.plotCandlesticksOnGrid(pd);
+
+    int rows = min(min(pd.numRows, plotRows), screenRows - 2); // the x labels take the row below
+    for (int r = 0; r < rows; r++) {
+        if (r % 5 == 0) {
+            stringstream label;
+            label << setw(3) << fixed << setprecision(0) << pd.minTemp + (pd.numRows - 1 - r) * pd.degreesPerRow << " ";
+            write(1 + r, 0, label.str());
+        }
+        for (int c = 0; c < pd.numCols && 4 + c < screenCols; c++) {
+            frame[(1 + r) * screenCols + 4 + c] = pd.grid[r][c];
+        }
+    }
+
+    stringstream labels;
+    for (const Candlestick& cs : visible) {
+        labels << setw(pd.labelWidth) << left << cs.timestamp << " ";
+    }
+    write(1 + rows, 4, labels.str());
+    return frame;
+}
+
+string InteractiveChart::diffFrames(const vector<string>& next) {
+    string out;
+    bool fullRedraw = previousFrame.size() != next.size();
+    if (fullRedraw) out += "\033[2J";
+
+    for (int r = 0; r < screenRows; r++) {
+        int c = 0;
+        while (c < screenCols) {
+            size_t cell = r * screenCols + c;
+            if (!fullRedraw && previousFrame[cell] == next[cell]) {
+                c++;
+                continue;
+            }
+            // extend the run while the unchanged gaps stay cheaper than another cursor move
+            int lastChanged = c;
+            for (int end = c + 1; end < screenCols && end - lastChanged <= maxGapToRewrite; end++) {
+                size_t endCell = r * screenCols + end;
+                if (fullRedraw || previousFrame[endCell] != next[endCell]) lastChanged = end;
+            }
+            out += "\033[" + to_string(r + 1) + ";" + to_string(c + 1) + "H";
+            for (int k = c; k <= lastChanged; k++) {
+                out += next[r * screenCols + k];
+            }
+            c = lastChanged + 1;
+        }
+    }
+    return out;
+}
+
+void InteractiveChart::draw() {
+    int rows, cols;
+    terminalSize(rows, cols);
+    if (rows != screenRows || cols != screenCols) {
+        screenRows = rows;
+        screenCols = cols;
+        previousFrame.clear(); // resized: nothing on screen can be reused
+        clampView();
+    }
+
+    vector<string> next = renderFrame();
+    string out = diffFrames(next);
+    // single buffered write per frame
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+    bytesSent = out.size();
+    previousFrame.swap(next);
+}
+
+bool InteractiveChart::handleKey(int key) {
+    size_t total = collection.getCandlesticks().size();
+    switch (key) {
+    case KeyEnd:
+    case KeyEscape:
+    case 'q':
+    case 'Q':
+        return false;
+    case KeyLeft:
+        if (firstVisible > 0) firstVisible--;
+        break;
+    case KeyRight:
+        if (firstVisible + visibleCount < total) firstVisible++;
+        break;
+    case '+':
+    case '=':
+    case KeyUp:
+        visibleCount = max<size_t>(3, visibleCount * 2 / 3);
+        break;
+    case '-':
+    case KeyDown:
+        visibleCount = visibleCount * 3 / 2 + 1;
+        break;
+    case 'c':
+        countryIndex = (countryIndex + 1) % countries.size();
+        reload();
+        break;
+    case 'C':
+        countryIndex = (countryIndex + countries.size() - 1) % countries.size();
+        reload();
+        break;
+    case 't':
+    case 'T':
+        // yearly -> months of the first visible year, monthly -> back to years around that year
+        if (timeframe == Timeframe::Yearly) {
+            if (total == 0) break;
+            year = collection.getCandlesticks()[firstVisible].timestamp.substr(0, 4);
+            timeframe = Timeframe::Monthly;
+            reload();
+            firstVisible = 0;
+        }
+        else {
+            string shownYear = year;
+            timeframe = Timeframe::Yearly;
+            year = "0";
+            reload();
+            const vector<Candlestick>& years = collection.getCandlesticks();
+            firstVisible = 0;
+            for (size_t i = 0; i < years.size(); i++) {
+                if (years[i].timestamp == shownYear) firstVisible = i;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+    clampView();
+    return true;
+}
+
+void InteractiveChart::run() {
+    if (!isInteractiveTerminal()) {
+        cout << "Interactive chart needs a terminal." << endl;
+        return;
+    }
+    RawTerminal terminal;
+    draw();
+    while (handleKey(readKey())) {
+        draw();
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "CandlesticksCollection.h"
+#include <vector>
+#include <string>
+using namespace std;
+
+// full-screen candlestick view: arrows pan, +/- zoom, c/C switch country, t switch timeframe, q or Esc quits
+// the previous frame is kept so only the cells that changed are sent to the terminal
+class InteractiveChart {
+public:
+    // the snapshot is kept for the whole session, so a reload meanwhile does not change the data under the view
+    InteractiveChart(shared_ptr<const DatasetSnapshot> snapshot,
+        string country,
+        float minTemp = numeric_limits<float>::lowest(),
+        float maxTemp = numeric_limits<float>::max(),
+        string startDate = "",
+        string endDate = "");
+    void run();
+
+private:
+    shared_ptr<const DatasetSnapshot> snapshot;
+    vector<string> countries;
+    size_t countryIndex;
+    Timeframe timeframe;
+    string year;
+    float minTemp;
+    float maxTemp;
+    string startDate;
+    string endDate;
+    CandlesticksCollection collection;
+
+    // view state
+    size_t firstVisible;
+    size_t visibleCount;
+    int screenRows;
+    int screenCols;
+    size_t bytesSent;
+
+    // one string per terminal cell (a cell may carry ANSI colour codes)
+    vector<string> previousFrame;
+
+    void reload();
+    void clampView();
+    size_t maxVisible() const;
+    vector<string> renderFrame();
+    // cursor-move + write sequences turning the previous frame into the next one
+    string diffFrames(const vector<string>& next);
+    void draw();
+    bool handleKey(int key);
+};
@@ -0,0 +1,349 @@
+#include "OutOfCoreAggregator.h"
+#include "DatasetManifest.h"
+#include "WeatherTable.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+using namespace std;
+
+// per file parsing context, plus the date group of the previous line so the filter only runs on changes
+struct LineScanner {
+    vector<int> countryOfField; // csv field -> requested country, -1 if not requested
+    size_t numColumns = 0;
+    size_t keyLength = 4;
+    bool singleYear = false;
+    string year;
+    const DataFilters* filters = nullptr;
+    bool extendedStats = false;
+
+    string lineGroup;
+    bool lineGroupInRange = false;
+    size_t skippedLines = 0;
+    size_t invalidStamps = 0;
+    size_t invalidValues = 0;
+
+    // line must be NUL terminated
+    void scan(const char* line, size_t length, size_t numCountries, map<string, vector<PeriodAccumulator>>& groups) {
+        if (length == 0) return;
+
+        // count fields the way CSVReader::tokenise does: a trailing separator adds no field
+        size_t fields = 1 + count(line, line + length, ',');
+        if (line[length - 1] == ',') fields--;
+        if (fields < numColumns) {
+            skippedLines++;
+            return;
+        }
+
+        const char* comma = strchr(line, ',');
+        size_t stampLength = comma ? static_cast<size_t>(comma - line) : length;
+        if (WeatherTable::packStamp(line, stampLength) < 0) { // month 13, hour 99, ... like the other engines
+            invalidStamps++;
+            return;
+        }
+        if (singleYear && (stampLength < 4 || memcmp(line, year.data(), 4) != 0)) return; // other year
+        size_t groupLength = min(keyLength, stampLength);
+        if (lineGroup.size() != groupLength || memcmp(line, lineGroup.data(), groupLength) != 0) {
+            lineGroup.assign(line, groupLength);
+            lineGroupInRange = !lineGroup.empty() && filters->isInDateRange(lineGroup);
+        }
+        if (!lineGroupInRange) return;
+
+        vector<PeriodAccumulator>* group = nullptr;
+        size_t field = 1;
+        while (comma && field < countryOfField.size()) {
+            const char* value = comma + 1;
+            comma = strchr(value, ',');
+            int country = countryOfField[field++];
+            if (country == -1) continue;
+
+            char* end;
+            errno = 0;
+            float temperature = strtof(value, &end);
+            if (end == value || errno == ERANGE || !isfinite(temperature)) {
+                invalidValues++;
+                continue;
+            }
+            // groups are only created by a valid reading, like the streaming engine
+            if (!group) {
+                auto found = groups.find(lineGroup);
+                if (found == groups.end()) {
+                    found = groups.emplace(lineGroup, vector<PeriodAccumulator>(numCountries, PeriodAccumulator(extendedStats))).first;
+                }
+                group = &found->second;
+            }
+            (*group)[country].add(temperature);
+        }
+    }
+};
+
+static void writeGroup(ostream& out, const string& group, const vector<PeriodAccumulator>& accumulators) {
+    uint32_t length = static_cast<uint32_t>(group.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(group.data(), length);
+    for (const PeriodAccumulator& accumulator : accumulators) {
+        accumulator.write(out);
+    }
+}
+
+// sorted run of spilled groups, read back one group at a time
+struct SpillRun {
+    ifstream in;
+    string group;
+    vector<PeriodAccumulator> accumulators;
+    bool valid = false;
+
+    SpillRun(const string& path, size_t numCountries, bool extendedStats) :
+        in(path, ios::binary),
+        accumulators(numCountries, PeriodAccumulator(extendedStats))
+    {
+        if (!in.is_open()) {
+            cerr << "Error: Could not read spill file '" << path << "'." << endl;
+            throw runtime_error("Could not read spilled aggregates");
+        }
+        next();
+    }
+
+    void next() {
+        uint32_t length;
+        valid = static_cast<bool>(in.read(reinterpret_cast<char*>(&length), sizeof(length)));
+        if (!valid) return;
+        group.resize(length);
+        valid = static_cast<bool>(in.read(&group[0], length));
+        for (size_t c = 0; valid && c < accumulators.size(); c++) {
+            valid = accumulators[c].read(in);
+        }
+    }
+};
+
+// removes the run files of a computation when it ends, also when it ends with an exception
+struct RunFileGuard {
+    vector<string>& paths;
+    ~RunFileGuard() {
+        for (const string& path : paths) {
+            remove(path.c_str());
+        }
+        paths.clear();
+    }
+};
+
+OutOfCoreAggregator::OutOfCoreAggregator(const OutOfCoreOptions& options) :
+    options{ options } {}
+
+size_t OutOfCoreAggregator::groupBytes(size_t numCountries, bool extendedStats) const {
+    // map node and key, plus the accumulators (and their fixed sketch bins when extended)
+    size_t sketchBytes = extendedStats ?
+        static_cast<size_t>((QuantileSketch::maxValue - QuantileSketch::minValue) / QuantileSketch::binWidth) * sizeof(uint32_t) : 0;
+    return 96 + numCountries * (sizeof(PeriodAccumulator) + sketchBytes);
+}
+
+string OutOfCoreAggregator::newRunPath() {
+    string path = options.spillDirectory + "/weather_spill_" +
+        to_string(chrono::steady_clock::now().time_since_epoch().count()) + "_" + to_string(spills++) + ".bin";
+    createdRuns.push_back(path);
+    return path;
+}
+
+void OutOfCoreAggregator::spill(GroupTable& groups) {
+    string path = newRunPath();
+    ofstream out(path, ios::binary);
+    if (!out.is_open()) {
+        cerr << "Error: Could not create spill file '" << path << "'." << endl;
+        throw runtime_error("Could not spill aggregates");
+    }
+    // std::map keeps groups sorted, so every run can be merged back in order
+    for (const auto& group : groups) {
+        writeGroup(out, group.first, group.second);
+    }
+    spillFiles.push_back(path);
+    groups.clear();
+}
+
+void OutOfCoreAggregator::mergeRuns(const vector<string>& paths, size_t numCountries, bool extendedStats,
+    const function<void(const string&, const vector<PeriodAccumulator>&)>& output)
+{
+    vector<unique_ptr<SpillRun>> runs;
+    for (const string& path : paths) {
+        runs.emplace_back(new SpillRun(path, numCountries, extendedStats));
+    }
+    while (true) {
+        const string* smallest = nullptr;
+        for (const auto& run : runs) {
+            if (run->valid && (!smallest || run->group < *smallest)) smallest = &run->group;
+        }
+        if (!smallest) break;
+
+        string group = *smallest;
+        vector<PeriodAccumulator> merged(numCountries, PeriodAccumulator(extendedStats));
+        for (auto& run : runs) {
+            if (!run->valid || run->group != group) continue;
+            for (size_t c = 0; c < numCountries; c++) {
+                merged[c].merge(run->accumulators[c]);
+            }
+            run->next();
+        }
+        output(group, merged);
+    }
+    runs.clear();
+    for (const string& path : paths) {
+        remove(path.c_str());
+    }
+}
+
+map<string, vector<Candlestick>> OutOfCoreAggregator::computeCandlesticks(const string& filePath,
+    const vector<string>& countries,
+    Timeframe timeframe,
+    const string& year,
+    float minTemp,
+    float maxTemp,
+    string startDate,
+    string endDate,
+    bool extendedStats)
+{
+    spillFiles.clear();
+    spills = 0;
+    peakBytes = 0;
+    RunFileGuard cleanup{ createdRuns };
+
+    vector<string> known = DatasetManifest::datasetColumns(filePath);
+    for (const string& country : countries) {
+        if (find(known.begin(), known.end(), country) == known.end()) {
+            cerr << "Error: Country '" << country << "' not found in the header." << endl;
+            throw invalid_argument("Country not found");
+        }
+    }
+    vector<string> files = DatasetManifest::resolveFiles(filePath, "", timeframe, year, startDate, endDate);
+
+    DataFilters filters{ minTemp, maxTemp, startDate, endDate };
+    LineScanner scanner;
+    // monthly without a year groups by year, exactly like the yearly timeframe
+    scanner.singleYear = timeframe == Timeframe::Monthly && year != "0";
+    scanner.keyLength = scanner.singleYear ? 7 : 4;
+    scanner.year = year;
+    scanner.filters = &filters;
+    scanner.extendedStats = extendedStats;
+
+    size_t numCountries = countries.size();
+    size_t bytesPerGroup = groupBytes(numCountries, extendedStats);
+    GroupTable groups;
+    vector<char> buffer(options.chunkSize + 1);
+
+    for (const string& path : files) {
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open the file." << endl;
+            return {};
+        }
+        string header;
+        if (!getline(file, header)) {
+            cerr << "Error: File is empty." << endl;
+            return {};
+        }
+        vector<string> headers = CSVReader::tokenise(header, ',');
+        scanner.numColumns = headers.size();
+        scanner.countryOfField.assign(headers.size(), -1);
+        for (size_t i = 0; i < headers.size(); i++) {
+            auto found = find(countries.begin(), countries.end(), headers[i]);
+            if (found != countries.end()) scanner.countryOfField[i] = static_cast<int>(found - countries.begin());
+        }
+
+        // fixed-size chunks; a line cut by the chunk end is moved to the front of the buffer
+        size_t pending = 0;
+        while (true) {
+            file.read(buffer.data() + pending, buffer.size() - 1 - pending);
+            size_t end = pending + static_cast<size_t>(file.gcount());
+            if (end == pending) break;
+
+            size_t start = 0;
+            char* newline;
+            while ((newline = static_cast<char*>(memchr(buffer.data() + start, '\n', end - start))) != nullptr) {
+                *newline = '\0';
+                size_t length = newline - (buffer.data() + start);
+                scanner.scan(buffer.data() + start, length, numCountries, groups);
+                start += length + 1;
+
+                size_t bytes = groups.size() * bytesPerGroup;
+                peakBytes = max(peakBytes, bytes + buffer.size());
+                if (bytes > options.memoryCap) {
+                    spill(groups);
+                }
+            }
+            pending = end - start;
+            memmove(buffer.data(), buffer.data() + start, pending);
+            if (pending + 1 >= buffer.size()) {
+                buffer.resize(buffer.size() * 2); // single line longer than a chunk
+            }
+        }
+        if (pending > 0) {
+            buffer[pending] = '\0';
+            scanner.scan(buffer.data(), pending, numCountries, groups);
+        }
+    }
+
+    if (scanner.skippedLines > 0) {
+        cerr << "Warning: " << scanner.skippedLines << " lines with insufficient columns skipped." << endl;
+    }
+    if (scanner.invalidStamps > 0) {
+        cerr << "Warning: " << scanner.invalidStamps << " lines with invalid timestamps skipped." << endl;
+    }
+    if (scanner.invalidValues > 0) {
+        cerr << "Warning: " << scanner.invalidValues << " invalid temperature values skipped." << endl;
+    }
+
+    // candlesticks in date group order, open is the previous close of the same country
+    map<string, vector<Candlestick>> result;
+    vector<bool> firstGroup(numCountries, true);
+    vector<float> previousClose(numCountries, 0.0f);
+    for (const string& country : countries) {
+        result[country];
+    }
+    auto emit = [&](const string& group, const vector<PeriodAccumulator>& accumulators) {
+        for (size_t c = 0; c < numCountries; c++) {
+            const PeriodAccumulator& accumulator = accumulators[c];
+            if (accumulator.tempCount == 0) continue;
+            float close = accumulator.close();
+            float open = firstGroup[c] ? close : previousClose[c];
+            if (accumulator.high <= filters.maxTemp && accumulator.low >= filters.minTemp) {
+                result[countries[c]].push_back(accumulator.toCandlestick(open, group));
+            }
+            previousClose[c] = close;
+            firstGroup[c] = false;
+        }
+    };
+
+    if (spillFiles.empty()) {
+        for (const auto& group : groups) {
+            emit(group.first, group.second);
+        }
+        return result;
+    }
+
+    spill(groups);
+    // runs are merged in passes of at most maxOpenRuns files, so the open files stay bounded too
+    size_t fanIn = max<size_t>(options.maxOpenRuns, 2);
+    while (spillFiles.size() > fanIn) {
+        vector<string> batch(spillFiles.begin(), spillFiles.begin() + fanIn);
+        spillFiles.erase(spillFiles.begin(), spillFiles.begin() + fanIn);
+        string path = newRunPath();
+        ofstream out(path, ios::binary);
+        if (!out.is_open()) {
+            cerr << "Error: Could not create spill file '" << path << "'." << endl;
+            throw runtime_error("Could not spill aggregates");
+        }
+        mergeRuns(batch, numCountries, extendedStats, [&](const string& group, const vector<PeriodAccumulator>& accumulators) {
+            writeGroup(out, group, accumulators);
+        });
+        spillFiles.push_back(path);
+    }
+    mergeRuns(spillFiles, numCountries, extendedStats, emit);
+    spillFiles.clear();
+    return result;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "CsvReader.h"
+#include "StreamingStats.h"
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+using namespace std;
+
+struct OutOfCoreOptions {
+    size_t memoryCap = 256u << 20;   // bytes of aggregate state before spilling to disk
+    size_t chunkSize = 4u << 20;     // bytes read from the input at a time
+    string spillDirectory = ".";
+    size_t maxOpenRuns = 64;         // spill runs merged at once, more are merged in passes
+};
+
+// bounded-memory candlestick engine for inputs larger than RAM: the input is streamed in fixed-size
+// chunks and only per-period aggregates of the requested countries are kept; when they outgrow the
+// memory cap they are spilled to sorted run files that are merged back period by period at the end
+// for time-ordered input the candlesticks match CSVReader::computeCandlesticks (gap filling is not supported)
+class OutOfCoreAggregator {
+public:
+    explicit OutOfCoreAggregator(const OutOfCoreOptions& options = OutOfCoreOptions());
+
+    map<string, vector<Candlestick>> computeCandlesticks(const string& filePath,
+        const vector<string>& countries,
+        Timeframe timeframe,
+        const string& year,
+        float minTemp = numeric_limits<float>::lowest(),
+        float maxTemp = numeric_limits<float>::max(),
+        string startDate = "",
+        string endDate = "",
+        bool extendedStats = false);
+
+    size_t spillCount() const { return spills; }
+    size_t peakMemory() const { return peakBytes; }
+    // estimated bytes held per date group, counted against the memory cap
+    size_t groupBytes(size_t numCountries, bool extendedStats) const;
+
+private:
+    // date group -> one accumulator per requested country
+    typedef map<string, vector<PeriodAccumulator>> GroupTable;
+
+    OutOfCoreOptions options;
+    vector<string> spillFiles;  // runs still to be merged
+    vector<string> createdRuns; // every run file of the current computation, removed when it ends
+    size_t spills = 0;
+    size_t peakBytes = 0;
+
+    string newRunPath();
+    void spill(GroupTable& groups);
+    // merge sorted runs group by group, holding a single group per run in memory
+    void mergeRuns(const vector<string>& paths, size_t numCountries, bool extendedStats,
+        const function<void(const string&, const vector<PeriodAccumulator>&)>& output);
+};
@@ -0,0 +1,129 @@
+#include "Regions.h"
+#include "WeatherTable.h"
+#include "DatasetManifest.h"
+#include "CsvReader.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+using namespace std;
+
+const string RegionSet::configName = "regions.cfg";
+
+string RegionSet::configPath(const string& datasetPath) {
+    if (DatasetManifest::isPartitioned(datasetPath)) {
+        return datasetPath + "/" + configName;
+    }
+    size_t slash = datasetPath.find_last_of("/\\");
+    return slash == string::npos ? configName : datasetPath.substr(0, slash + 1) + configName;
+}
+
+RegionSet RegionSet::load(const string& configFile) {
+    RegionSet set;
+    ifstream file(configFile);
+    if (!file.is_open()) return set;
+
+    string line;
+    while (getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        vector<string> tokens = CSVReader::tokenise(line, ',');
+        if (tokens.size() < 2) {
+            cerr << "Warning: Invalid region definition '" << line << "' skipped." << endl;
+            continue;
+        }
+        Region region;
+        region.name = tokens[0];
+        bool valid = true;
+        for (const string& member : CSVReader::tokenise(tokens[1], ';')) {
+            size_t colon = member.find(':');
+            float weight = 1.0f;
+            try {
+                if (colon != string::npos) weight = stof(member.substr(colon + 1));
+            }
+            catch (const exception& e) {
+                valid = false;
+                break;
+            }
+            if (weight <= 0.0f) {
+                valid = false;
+                break;
+            }
+            region.members.emplace_back(member.substr(0, colon), weight);
+        }
+        if (!valid || region.members.empty()) {
+            cerr << "Warning: Invalid region definition '" << line << "' skipped." << endl;
+            continue;
+        }
+        set.regions.push_back(region);
+    }
+    return set;
+}
+
+const Region* RegionSet::find(const string& name) const {
+    for (const Region& region : regions) {
+        if (region.name == name) return &region;
+    }
+    return nullptr;
+}
+
+string RegionSet::fingerprint() const {
+    uint64_t hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+    for (const Region& region : regions) {
+        add(region.name.c_str(), region.name.size() + 1); // the terminator separates the fields
+        for (const pair<string, float>& member : region.members) {
+            add(member.first.c_str(), member.first.size() + 1);
+            uint32_t weight;
+            memcpy(&weight, &member.second, sizeof(weight));
+            add(&weight, sizeof(weight));
+        }
+        add("\n", 1);
+    }
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+bool RegionSet::materialize(WeatherTable& table, const Region& region) {
+    size_t numRows = table.numRows();
+    vector<float> weighted(numRows, 0.0f), weights(numRows, 0.0f);
+    for (const pair<string, float>& member : region.members) {
+        int index = table.columnIndex(member.first);
+        if (index == -1) return false;
+        const float* values = table.columns[index].data();
+        float weight = member.second;
+        float* sum = weighted.data();
+        float* total = weights.data();
+        // branch free, so the compiler can vectorise the pass over the column
+        for (size_t r = 0; r < numRows; r++) {
+            bool valid = !WeatherTable::isMissing(values[r]);
+            sum[r] += valid ? weight * values[r] : 0.0f;
+            total[r] += valid ? weight : 0.0f;
+        }
+    }
+
+    vector<float> combined(numRows);
+    GapBitmap validity;
+    if (!table.validity.empty()) validity.firstHour = table.validity[0].firstHour;
+    for (size_t r = 0; r < numRows; r++) {
+        if (weights[r] > 0.0f) {
+            combined[r] = weighted[r] / weights[r];
+            validity.mark(DataQuality::hourOf(table.stamps[r]));
+        }
+        else {
+            combined[r] = WeatherTable::missing();
+        }
+    }
+    if (numRows > 0) validity.extendTo(DataQuality::hourOf(table.stamps.back()));
+
+    table.columnNames.push_back(region.name);
+    table.columns.push_back(move(combined));
+    table.validity.push_back(move(validity));
+    return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <utility>
+using namespace std;
+
+class WeatherTable;
+
+// named weighted combination of country columns, e.g. Iberia = 0.8 x ES + 0.2 x PT
+struct Region {
+    string name;
+    vector<pair<string, float>> members; // column, weight
+};
+
+// regions defined in a regions.cfg next to the dataset (inside it for a partitioned directory), not a .csv
+// so that a manifest built from dir/*.csv never takes it for a partition
+// one region per line: name,column[:weight];column[:weight];... with weights defaulting to 1
+class RegionSet {
+public:
+    static const string configName;
+
+    static string configPath(const string& datasetPath);
+    static RegionSet load(const string& configFile); // empty when there is no config file
+
+    const Region* find(const string& name) const;
+    // 64-bit FNV-1a hash of the parsed definitions (names, members and weights) as 16 hex digits,
+    // stable across runs so it can be stored in caches built from region columns
+    string fingerprint() const;
+    bool empty() const { return regions.empty(); }
+
+    // append the region as a new column of the table: per row, the weighted mean of the members with
+    // a valid reading (weights renormalised over them), missing when none has one
+    // returns false if a member column is not loaded
+    static bool materialize(WeatherTable& table, const Region& region);
+
+    vector<Region> regions;
+};
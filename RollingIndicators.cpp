@@ -0,0 +1,81 @@
+#include "RollingIndicators.h"
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+RollingWindow::RollingWindow(int size) :
+    size{ max(size, 1) } {}
+
+void RollingWindow::push(double value) {
+    values.push_back(value);
+    sum += value;
+    sumSquares += value * value;
+    if (static_cast<int>(values.size()) > size) {
+        double oldest = values.front();
+        values.pop_front();
+        sum -= oldest;
+        sumSquares -= oldest * oldest;
+    }
+}
+
+double RollingWindow::mean() const {
+    return values.empty() ? 0.0 : sum / values.size();
+}
+
+double RollingWindow::stddev() const {
+    if (values.empty()) return 0.0;
+    double m = mean();
+    // rounding in the running sums can leave a tiny negative variance for a flat window
+    return sqrt(max(sumSquares / values.size() - m * m, 0.0));
+}
+
+RollingExtremes::RollingExtremes(int size) :
+    size{ max(size, 1) } {}
+
+void RollingExtremes::push(double high, double low) {
+    while (!maxima.empty() && maxima.back().second <= high) maxima.pop_back();
+    maxima.emplace_back(count, high);
+    while (!minima.empty() && minima.back().second >= low) minima.pop_back();
+    minima.emplace_back(count, low);
+
+    // drop the values that slid out of the window
+    long long oldest = count - size + 1;
+    while (maxima.front().first < oldest) maxima.pop_front();
+    while (minima.front().first < oldest) minima.pop_front();
+    count++;
+}
+
+CandleIndicators::CandleIndicators(int window, double bandWidth) :
+    bandWidth{ bandWidth },
+    alpha{ 2.0 / (max(window, 1) + 1) },
+    closes{ window },
+    extremes{ window } {}
+
+IndicatorPoint CandleIndicators::push(const Candlestick& candle) {
+    closes.push(candle.close);
+    extremes.push(candle.high, candle.low);
+    // seeded with the first close, so the ema has warmed up over a window by the time it is reported
+    ema = hasEma ? ema + alpha * (candle.close - ema) : candle.close;
+    hasEma = true;
+
+    IndicatorPoint point;
+    point.ready = closes.full();
+    point.sma = closes.mean();
+    point.ema = ema;
+    double deviation = closes.stddev();
+    point.upperBand = point.sma + bandWidth * deviation;
+    point.lowerBand = point.sma - bandWidth * deviation;
+    point.rollingHigh = extremes.high();
+    point.rollingLow = extremes.low();
+    return point;
+}
+
+vector<IndicatorPoint> CandleIndicators::compute(const vector<Candlestick>& candlesticks, int window, double bandWidth) {
+    CandleIndicators indicators(window, bandWidth);
+    vector<IndicatorPoint> points;
+    points.reserve(candlesticks.size());
+    for (const Candlestick& candle : candlesticks) {
+        points.push_back(indicators.push(candle));
+    }
+    return points;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "Candlestick.h"
+#include <deque>
+#include <vector>
+#include <utility>
+using namespace std;
+
+// mean and standard deviation of the last size values, from a running sum and sum of squares
+class RollingWindow {
+public:
+    explicit RollingWindow(int size);
+
+    void push(double value);
+    bool full() const { return static_cast<int>(values.size()) == size; }
+    double mean() const;
+    double stddev() const; // population
+
+private:
+    int size;
+    deque<double> values;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+};
+
+// highest high and lowest low of the last size candles, with monotonic deques of (index, value)
+// every value enters and leaves each deque once, so a push is amortised O(1)
+class RollingExtremes {
+public:
+    explicit RollingExtremes(int size);
+
+    void push(double high, double low);
+    double high() const { return maxima.front().second; }
+    double low() const { return minima.front().second; }
+
+private:
+    int size;
+    long long count = 0;
+    deque<pair<long long, double>> maxima; // decreasing values
+    deque<pair<long long, double>> minima; // increasing values
+};
+
+// indicator values at one candle, ready once a full window of candles is available
+struct IndicatorPoint {
+    bool ready = false;
+    double sma = 0.0;
+    double ema = 0.0;
+    double upperBand = 0.0; // sma +/- bandWidth standard deviations of close
+    double lowerBand = 0.0;
+    double rollingHigh = 0.0;
+    double rollingLow = 0.0;
+};
+
+// moving averages of close, bollinger style bands and rolling extremes over a candle series
+// push() updates every indicator in O(1), so a series growing one candle at a time never recomputes its window
+class CandleIndicators {
+public:
+    CandleIndicators(int window, double bandWidth = 2.0);
+
+    IndicatorPoint push(const Candlestick& candle);
+
+    // whole series in one O(n) pass
+    static vector<IndicatorPoint> compute(const vector<Candlestick>& candlesticks, int window, double bandWidth = 2.0);
+
+private:
+    double bandWidth;
+    double alpha; // ema smoothing, 2 / (window + 1)
+    bool hasEma = false;
+    double ema = 0.0;
+    RollingWindow closes;
+    RollingExtremes extremes;
+};
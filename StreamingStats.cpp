@@ -0,0 +1,198 @@
+#include "StreamingStats.h"
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include "DataQuality.h"
+using namespace std;
+
+void RunningStats::add(double value) {
+    count++;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    long long combined = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / combined;
+    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / combined);
+    count = combined;
+}
+
+double RunningStats::variance() const {
+    return count > 1 ? m2 / (count - 1) : 0.0;
+}
+
+double RunningStats::stddev() const {
+    return sqrt(variance());
+}
+
+const double QuantileSketch::minValue = -100.0;
+const double QuantileSketch::maxValue = 100.0;
+const double QuantileSketch::binWidth = 0.1;
+
+int QuantileSketch::binOf(double value) const {
+    // values outside the domain are clamped to the edge bins
+    int numBins = static_cast<int>(bins.size());
+    int bin = static_cast<int>(floor((value - minValue) / binWidth));
+    return max(0, min(numBins - 1, bin));
+}
+
+void QuantileSketch::add(double value) {
+    if (!isfinite(value)) return; // no bin for nan, and converting it to a bin index is undefined
+    if (bins.empty()) {
+        bins.assign(static_cast<size_t>(round((maxValue - minValue) / binWidth)), 0);
+    }
+    bins[binOf(value)]++;
+    total++;
+}
+
+void QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.total == 0) return;
+    if (bins.empty()) {
+        *this = other;
+        return;
+    }
+    for (size_t i = 0; i < bins.size(); i++) {
+        bins[i] += other.bins[i];
+    }
+    total += other.total;
+}
+
+double QuantileSketch::quantile(double q) const {
+    if (total == 0) return 0.0;
+    // nearest-rank quantile, reported at the bin centre (error is at most half a bin)
+    long long rank = max(1LL, static_cast<long long>(ceil(q * total)));
+    long long seen = 0;
+    for (size_t i = 0; i < bins.size(); i++) {
+        seen += bins[i];
+        if (seen >= rank) {
+            return minValue + (i + 0.5) * binWidth;
+        }
+    }
+    return maxValue;
+}
+
+void QuantileSketch::clear() {
+    // keep the allocation, periods are reset far more often than they are created
+    fill(bins.begin(), bins.end(), 0);
+    total = 0;
+}
+
+template <typename T>
+static void writeValue(ostream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+static bool readValue(istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+void QuantileSketch::write(ostream& out) const {
+    writeValue(out, total);
+    uint32_t nonEmpty = static_cast<uint32_t>(count_if(bins.begin(), bins.end(), [](uint32_t c) { return c > 0; }));
+    writeValue(out, nonEmpty);
+    for (uint32_t i = 0; i < bins.size(); i++) {
+        if (bins[i] == 0) continue;
+        writeValue(out, i);
+        writeValue(out, bins[i]);
+    }
+}
+
+bool QuantileSketch::read(istream& in) {
+    clear();
+    uint32_t nonEmpty;
+    if (!readValue(in, total) || !readValue(in, nonEmpty)) return false;
+    if (nonEmpty > 0) {
+        bins.assign(static_cast<size_t>(round((maxValue - minValue) / binWidth)), 0);
+    }
+    for (uint32_t k = 0; k < nonEmpty; k++) {
+        uint32_t i, count;
+        if (!readValue(in, i) || !readValue(in, count) || i >= bins.size()) return false;
+        bins[i] = count;
+    }
+    return true;
+}
+
+void PeriodAccumulator::write(ostream& out) const {
+    writeValue(out, sumTemperatures);
+    writeValue(out, tempCount);
+    writeValue(out, observedCount);
+    writeValue(out, high);
+    writeValue(out, low);
+    if (extendedStats) {
+        writeValue(out, moments);
+        sketch.write(out);
+    }
+}
+
+bool PeriodAccumulator::read(istream& in) {
+    bool ok = readValue(in, sumTemperatures) && readValue(in, tempCount) && readValue(in, observedCount) &&
+        readValue(in, high) && readValue(in, low);
+    if (ok && extendedStats) {
+        ok = readValue(in, moments) && sketch.read(in);
+    }
+    return ok;
+}
+
+void PeriodAccumulator::addFilled(const float* temperatures, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        sumTemperatures += temperatures[i];
+    }
+    for (size_t i = 0; i < count; i++) {
+        high = max(high, temperatures[i]);
+        low = min(low, temperatures[i]);
+    }
+    tempCount += static_cast<int>(count);
+    if (extendedStats) {
+        for (size_t i = 0; i < count; i++) {
+            moments.add(temperatures[i]);
+            sketch.add(temperatures[i]);
+        }
+    }
+}
+
+void PeriodAccumulator::merge(const PeriodAccumulator& other) {
+    sumTemperatures += other.sumTemperatures;
+    tempCount += other.tempCount;
+    observedCount += other.observedCount;
+    high = max(high, other.high);
+    low = min(low, other.low);
+    if (extendedStats) {
+        moments.merge(other.moments);
+        sketch.merge(other.sketch);
+    }
+}
+
+void PeriodAccumulator::reset() {
+    sumTemperatures = 0.0f;
+    tempCount = 0;
+    observedCount = 0;
+    high = numeric_limits<float>::lowest();
+    low = numeric_limits<float>::max();
+    moments = RunningStats();
+    sketch.clear();
+}
+
+Candlestick PeriodAccumulator::toCandlestick(float open, const string& timestamp) const {
+    Candlestick candlestick(open, high, low, close(), timestamp);
+    int expected = DataQuality::hoursInPeriod(timestamp);
+    if (expected > 0) {
+        candlestick.coverage = min(100.0, 100.0 * observedCount / expected);
+    }
+    if (extendedStats && moments.count > 0) {
+        candlestick.stats.available = true;
+        candlestick.stats.stddev = moments.stddev();
+        candlestick.stats.p10 = sketch.quantile(0.1);
+        candlestick.stats.median = sketch.quantile(0.5);
+        candlestick.stats.p90 = sketch.quantile(0.9);
+    }
+    return candlestick;
+}
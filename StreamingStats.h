@@ -0,0 +1,81 @@
+#pragma once
+#include "Candlestick.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <iosfwd>
+using namespace std;
+
+// Welford running mean/variance, mergeable with Chan's parallel formula
+struct RunningStats {
+    long long count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;
+
+    void add(double value);
+    void merge(const RunningStats& other);
+    double variance() const;
+    double stddev() const;
+};
+
+// bounded-memory quantile sketch: fixed 0.1 degree bins over the plausible temperature domain
+// merging is exact (bin counts are added), so partial sketches from threads or finer periods combine freely
+class QuantileSketch {
+public:
+    static const double minValue;
+    static const double maxValue;
+    static const double binWidth;
+
+    void add(double value);
+    void merge(const QuantileSketch& other);
+    double quantile(double q) const;
+    long long count() const { return total; }
+    void clear();
+    // binary form for spilling partial aggregates (only non-empty bins are written)
+    void write(ostream& out) const;
+    bool read(istream& in);
+
+private:
+    vector<uint32_t> bins; // allocated on first value so empty periods cost nothing
+    long long total = 0;
+    int binOf(double value) const;
+};
+
+// aggregation state of one candlestick period, shared by all engines building candles
+struct PeriodAccumulator {
+    explicit PeriodAccumulator(bool extendedStats = false) : extendedStats{ extendedStats } {}
+
+    bool extendedStats;
+    float sumTemperatures = 0.0f;
+    int tempCount = 0;
+    int observedCount = 0; // readings from the file, tempCount also includes interpolated ones
+    float high = numeric_limits<float>::lowest();
+    float low = numeric_limits<float>::max();
+    RunningStats moments;
+    QuantileSketch sketch;
+
+    void add(float temperature) {
+        observedCount++;
+        addFilled(temperature);
+    }
+    void addFilled(float temperature) {
+        sumTemperatures += temperature;
+        tempCount++;
+        high = max(high, temperature);
+        low = min(low, temperature);
+        if (extendedStats) {
+            moments.add(temperature);
+            sketch.add(temperature);
+        }
+    }
+    // a run of interpolated readings; the sum keeps reading order so it matches adding them one by one
+    void addFilled(const float* temperatures, size_t count);
+    void merge(const PeriodAccumulator& other);
+    void reset();
+    void write(ostream& out) const;
+    bool read(istream& in);
+    float close() const { return sumTemperatures / tempCount; }
+    Candlestick toCandlestick(float open, const string& timestamp) const;
+};
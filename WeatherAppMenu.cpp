@@ -4,13 +4,22 @@
 #include <limits>
 #include <algorithm>
 #include "CsvReader.h"
+#include "Climatology.h"
+#include "CorrelationAnalysis.h"
+#include "InteractiveChart.h"
+#include "Heatmap.h"
+#include "CyclicProfile.h"
+#include "Exporter.h"
 
 using namespace std;
 
 WeatherAppMenu::WeatherAppMenu(const string& filename) :
-    filename{ filename } {
+    filename{ filename },
+    dataset{ filename } {
     //setting default timeframe
     currentTimeframe = Timeframe::Yearly;
+    // a changed file is picked up within two checks, once it is no longer being written
+    dataset.watch(60);
 };
 
 // init and start the menu loop
@@ -24,6 +33,7 @@ void WeatherAppMenu::init() {
             cout << "Exiting application. Goodbye!" << endl;
             break;
         }
+        refreshIfReloaded();
         processUserOption(input);
     }
 }
@@ -44,6 +54,15 @@ void WeatherAppMenu::printMenu() {
     cout << "7. Reset Filters" << endl;
     cout << "8. Predict temperatures" << endl;
     cout << "9. Exit" << endl;
+    cout << "10. Toggle Extended Statistics" << endl;
+    cout << "11. Anomaly View" << endl;
+    cout << "12. Country Correlation" << endl;
+    cout << "13. Interactive Chart" << endl;
+    cout << "14. Data Quality" << endl;
+    cout << "15. Rolling Indicators" << endl;
+    cout << "16. Heatmap" << endl;
+    cout << "17. Seasonal Profiles" << endl;
+    cout << "18. Export" << endl;
     cout << "=========================================" << endl;
 }
 
@@ -88,8 +107,35 @@ void WeatherAppMenu::processUserOption(int option) {
         break;
     case 9:
         break;
+    case 10:
+        toggleExtendedStats();
+        break;
+    case 11:
+        showAnomalies();
+        break;
+    case 12:
+        showCorrelations();
+        break;
+    case 13:
+        interactiveChart();
+        break;
+    case 14:
+        showDataQuality();
+        break;
+    case 15:
+        setIndicators();
+        break;
+    case 16:
+        plotHeatmap();
+        break;
+    case 17:
+        showProfiles();
+        break;
+    case 18:
+        exportData();
+        break;
     default:
-        cout << "Invalid choice. Please select a valid option (1-9)." << endl;
+        cout << "Invalid choice. Please select a valid option (1-18)." << endl;
     }
 }
 
@@ -134,9 +180,7 @@ void WeatherAppMenu::setFilters() {
     getline(cin, endDate);
 
     // updated candlesticks collection with new filters
-    collection = currentTimeframe == Timeframe::Monthly ?
-        CandlesticksCollection(filename, country, currentTimeframe, currentYear, minTemp, maxTemp, startDate, endDate) :
-        CandlesticksCollection(filename, country, currentTimeframe, "0", minTemp, maxTemp, startDate, endDate);
+    updateCollection();
 
     cout << "\nFilters updated successfully!" << endl;
     if (minTemp != numeric_limits<float>::lowest() || maxTemp != numeric_limits<float>::max() ||
@@ -153,6 +197,12 @@ void WeatherAppMenu::setFilters() {
     }
 }
 
+// full-screen chart redrawn incrementally, starting from the current country and filters
+void WeatherAppMenu::interactiveChart() {
+    InteractiveChart chart(dataset.current(), country, minTemp, maxTemp, startDate, endDate);
+    chart.run();
+}
+
 // print candlesticks in textual form
 void WeatherAppMenu::displayCandlesticks() {
     cout << "\nDisplaying Candlesticks:" << endl;
@@ -168,6 +218,133 @@ void WeatherAppMenu::plotStackedBars() {
     collection.plotStackedBars();
 }
 
+// whole history of the selected country at once, binned from the in-memory snapshot
+void WeatherAppMenu::plotHeatmap() {
+    cout << "\nHeatmap columns:" << endl;
+    cout << "1. Months" << endl;
+    cout << "2. Days of year" << endl;
+    int columnsOption = getUserOption();
+    if (columnsOption != 1 && columnsOption != 2) {
+        cout << "Invalid choice." << endl;
+        return;
+    }
+    cout << "Color by:" << endl;
+    cout << "1. Mean temperature" << endl;
+    cout << "2. Max temperature" << endl;
+    int statOption = getUserOption();
+    if (statOption != 1 && statOption != 2) {
+        cout << "Invalid choice." << endl;
+        return;
+    }
+
+    shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
+    Heatmap heatmap = Heatmap::build(snapshot->table({ country }), country,
+        columnsOption == 1 ? HeatmapColumns::Months : HeatmapColumns::DaysOfYear,
+        statOption == 1 ? HeatmapStat::Mean : HeatmapStat::Max,
+        startDate, endDate);
+    cout << endl;
+    heatmap.print();
+}
+
+// diurnal, weekly or seasonal profile of one or more countries over the current date filters
+void WeatherAppMenu::showProfiles() {
+    cout << "\nGroup readings by:" << endl;
+    cout << "1. Hour of day" << endl;
+    cout << "2. Day of week" << endl;
+    cout << "3. Month of year" << endl;
+    Cycle cycle;
+    switch (getUserOption()) {
+    case 1:
+        cycle = Cycle::HourOfDay;
+        break;
+    case 2:
+        cycle = Cycle::DayOfWeek;
+        break;
+    case 3:
+        cycle = Cycle::MonthOfYear;
+        break;
+    default:
+        cout << "Invalid choice." << endl;
+        return;
+    }
+
+    cout << "Enter countries separated by commas or press Enter for " << country << ": ";
+    string input;
+    getline(cin, input);
+    vector<string> countries = input.empty() ? vector<string>{ country } : CSVReader::tokenise(input, ',');
+
+    shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
+    CyclicProfile profile;
+    try {
+        profile = CyclicProfile::build(snapshot->table(countries, startDate, endDate), countries, cycle);
+    }
+    catch (const invalid_argument& e) {
+        cout << "Error: Invalid country name." << endl;
+        return;
+    }
+    for (const string& name : countries) {
+        cout << "\nProfile for " << name << ":" << endl;
+        profile.print(name);
+    }
+}
+
+// candlesticks (current timeframe and filters) or raw readings of one or more countries, at full precision
+void WeatherAppMenu::exportData() {
+    cout << "\nExport:" << endl;
+    cout << "1. Candlesticks" << endl;
+    cout << "2. Raw readings" << endl;
+    int what = getUserOption();
+    if (what != 1 && what != 2) {
+        cout << "Invalid choice." << endl;
+        return;
+    }
+    cout << "Enter format (csv, ndjson or binary): ";
+    string input;
+    getline(cin, input);
+    ExportFormat format;
+    if (!Exporter::parseFormat(input, format)) {
+        cout << "Invalid format." << endl;
+        return;
+    }
+    cout << "Enter output file: ";
+    string path;
+    getline(cin, path);
+    cout << "Enter countries separated by commas or press Enter for " << country << ": ";
+    getline(cin, input);
+    vector<string> countries = input.empty() ? vector<string>{ country } : CSVReader::tokenise(input, ',');
+
+    shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
+    bool written;
+    if (what == 2) {
+        try {
+            written = Exporter::exportColumns(path, format, snapshot->table(countries), countries);
+        }
+        catch (const invalid_argument& e) {
+            cout << "Error: Invalid country name." << endl;
+            return;
+        }
+    }
+    else {
+        string year = currentTimeframe == Timeframe::Monthly ? currentYear : "0";
+        string period = CandlesticksCollection::timeframeToString(currentTimeframe) + (year != "0" ? " " + year : "");
+        vector<CandleSeries> series;
+        try {
+            for (const string& name : countries) {
+                series.push_back({ name, period, snapshot->computeCandlesticks(name, currentTimeframe, year,
+                    minTemp, maxTemp, startDate, endDate, extendedStats, maxGapFill) });
+            }
+        }
+        catch (const invalid_argument& e) {
+            cout << "Error: Invalid country name." << endl;
+            return;
+        }
+        written = Exporter::exportCandlesticks(path, format, series);
+    }
+    if (written) {
+        cout << "Exported to " << path << "." << endl;
+    }
+}
+
 // set/update timeframe, specifying year is required for monthly timeframe
 void WeatherAppMenu::setTimeframe() {
     cout << "\nSelect Timeframe:" << endl;
@@ -192,9 +369,7 @@ void WeatherAppMenu::setTimeframe() {
     setTimeframe(selectedTF);
 
     // update collection with new timeframe
-    collection = currentTimeframe == Timeframe::Monthly ?
-        CandlesticksCollection(filename, country, currentTimeframe, currentYear, minTemp, maxTemp, startDate, endDate) :
-        CandlesticksCollection(filename, country, currentTimeframe, "0", minTemp, maxTemp, startDate, endDate);
+    updateCollection();
 
     cout << "Timeframe updated to " << collection.timeframeToString(selectedTF);
     if (selectedTF == Timeframe::Monthly) {
@@ -213,7 +388,11 @@ void WeatherAppMenu::setCountry() {
         //validate that country actually exists in list
         try {
             currentTimeframe = Timeframe::Yearly;
-            collection = CandlesticksCollection(filename, country, currentTimeframe);
+            shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
+            collection = CandlesticksCollection(*snapshot, country, currentTimeframe, "0",
+                numeric_limits<float>::lowest(), numeric_limits<float>::max(), "", "", extendedStats, maxGapFill);
+            collection.setIndicators(indicatorWindow, bandWidth);
+            collectionVersion = snapshot->version;
             validCountry = true;
         }
         catch (const invalid_argument& e) {
@@ -240,9 +419,73 @@ void WeatherAppMenu::resetFilters() {
     startDate = "";
     endDate = "";
 
+    updateCollection();
+}
+
+// rebuild candlesticks collection from current timeframe, year and filters
+void WeatherAppMenu::updateCollection() {
+    // the snapshot stays alive for this query even if a reload publishes a newer one meanwhile
+    shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
     collection = currentTimeframe == Timeframe::Monthly ?
-        CandlesticksCollection(filename, country, currentTimeframe, currentYear, minTemp, maxTemp, startDate, endDate) :
-        CandlesticksCollection(filename, country, currentTimeframe, "0", minTemp, maxTemp, startDate, endDate);
+        CandlesticksCollection(*snapshot, country, currentTimeframe, currentYear, minTemp, maxTemp, startDate, endDate, extendedStats, maxGapFill) :
+        CandlesticksCollection(*snapshot, country, currentTimeframe, "0", minTemp, maxTemp, startDate, endDate, extendedStats, maxGapFill);
+    collection.setIndicators(indicatorWindow, bandWidth);
+    collectionVersion = snapshot->version;
+}
+
+// recompute the collection if a newer snapshot was published since it was built
+void WeatherAppMenu::refreshIfReloaded() {
+    if (dataset.current()->version == collectionVersion) return;
+    try {
+        updateCollection();
+        cout << "Dataset reloaded, candlesticks updated." << endl;
+    }
+    catch (const invalid_argument& e) {
+        collectionVersion = dataset.current()->version;
+        cout << "Warning: " << country << " is no longer in the reloaded dataset, keeping previous candlesticks." << endl;
+    }
+}
+
+// stddev, median and p10/p90 per candle, computed in the same pass as the candlesticks
+void WeatherAppMenu::toggleExtendedStats() {
+    extendedStats = !extendedStats;
+    updateCollection();
+    cout << "Extended statistics " << (extendedStats ? "enabled." : "disabled.") << endl;
+}
+
+// sma/ema, bands and rolling high/low over a window of candles, shown in the table and candlestick plot
+void WeatherAppMenu::setIndicators() {
+    cout << "\nEnter indicator window in periods (0 = off, Enter keeps " << indicatorWindow << "): ";
+    string input;
+    getline(cin, input);
+    try {
+        if (!input.empty()) {
+            int window = stoi(input);
+            if (window < 0) throw invalid_argument("Invalid window");
+            indicatorWindow = window;
+        }
+        if (indicatorWindow > 0) {
+            cout << "Enter band width in standard deviations (Enter keeps " << bandWidth << "): ";
+            getline(cin, input);
+            if (!input.empty()) {
+                double width = stod(input);
+                if (width < 0) throw invalid_argument("Invalid band width");
+                bandWidth = width;
+            }
+        }
+    }
+    catch (const exception& e) {
+        cout << "Invalid input. Indicators unchanged." << endl;
+        return;
+    }
+
+    collection.setIndicators(indicatorWindow, bandWidth);
+    if (indicatorWindow > 0) {
+        cout << "Indicators over " << indicatorWindow << " periods enabled." << endl;
+    }
+    else {
+        cout << "Indicators disabled." << endl;
+    }
 }
 
 void WeatherAppMenu::predictTemperatures() {
@@ -273,4 +516,134 @@ void WeatherAppMenu::predictTemperatures() {
             << candle.low << "\t"
             << candle.close << endl;
     }
+}
+
+// current series expressed as deviation from a climatology baseline over a reference period
+void WeatherAppMenu::showAnomalies() {
+    int startYear = 1981, endYear = 2010;
+    string input;
+    cout << "\nEnter reference period start year or press Enter for " << startYear << ": ";
+    getline(cin, input);
+    try {
+        if (!input.empty()) startYear = stoi(input);
+        cout << "Enter reference period end year or press Enter for " << endYear << ": ";
+        getline(cin, input);
+        if (!input.empty()) endYear = stoi(input);
+        if (endYear < startYear) throw invalid_argument("Invalid period");
+    }
+    catch (const exception& e) {
+        cout << "Invalid reference period." << endl;
+        return;
+    }
+
+    // baseline is kept between calls, only a different reference period or a reloaded dataset triggers a (cached) rebuild
+    shared_ptr<const DatasetSnapshot> snapshot = dataset.current();
+    if (climatology.startYear != startYear || climatology.endYear != endYear || climatologyVersion != snapshot->version) {
+        climatology = Climatology::loadOrBuild(*snapshot, startYear, endYear);
+        climatologyVersion = snapshot->version;
+    }
+    if (!climatology.hasColumn(country)) {
+        cout << "No climatology available for " << country << "." << endl;
+        return;
+    }
+
+    CandlesticksCollection anomalies = collection.withCandlesticks(
+        climatology.anomalies(country, collection.getCandlesticks()));
+
+    cout << "\nAnomalies relative to " << startYear << "-" << endYear << ":" << endl;
+    cout << "1. Display Candlesticks" << endl;
+    cout << "2. Plot Candlesticks" << endl;
+    cout << "3. Plot Stacked Bars" << endl;
+    switch (getUserOption()) {
+    case 1:
+        anomalies.displayCandlesticks();
+        break;
+    case 2:
+        anomalies.plotCandlesticks();
+        break;
+    case 3:
+        anomalies.plotStackedBars();
+        break;
+    default:
+        cout << "Invalid choice." << endl;
+    }
+}
+
+// pearson correlation of all countries over the current date filters and timeframe
+void WeatherAppMenu::showCorrelations() {
+    cout << "\nEnter lag in periods or press Enter for none: ";
+    string input;
+    getline(cin, input);
+    int lag = 0;
+    size_t topK = 5;
+    try {
+        if (!input.empty()) lag = stoi(input);
+        if (lag < 0) throw invalid_argument("Invalid lag");
+        cout << "How many similar countries to list? (Enter for " << topK << "): ";
+        getline(cin, input);
+        if (!input.empty()) topK = static_cast<size_t>(stoi(input));
+    }
+    catch (const exception& e) {
+        cout << "Invalid input." << endl;
+        return;
+    }
+
+    // monthly timeframe without explicit date filters covers the selected year only
+    string from = startDate, to = endDate;
+    if (currentTimeframe == Timeframe::Monthly && currentYear != "0" && from.empty() && to.empty()) {
+        from = to = currentYear;
+    }
+    WeatherTable table = dataset.current()->table({}, from, to);
+    CorrelationResult result = CorrelationAnalysis::compute(table, currentTimeframe, lag);
+
+    cout << "\n" << CandlesticksCollection::timeframeToString(currentTimeframe) << " correlation over "
+        << result.numPeriods << " periods (lag " << lag << "):" << endl << endl;
+    result.print();
+
+    cout << "\nMost similar to " << country << ":" << endl;
+    for (const pair<string, double>& similar : result.mostSimilar(country, topK)) {
+        cout << similar.first << "\t" << similar.second << endl;
+    }
+}
+
+// gaps in the selected country's hourly timeline, optional interpolation and per period coverage
+void WeatherAppMenu::showDataQuality() {
+    cout << "\nInterpolate gaps up to how many hours? (0 = off, Enter keeps " << maxGapFill << "): ";
+    string input;
+    getline(cin, input);
+    if (!input.empty()) {
+        try {
+            int hours = stoi(input);
+            if (hours < 0) throw invalid_argument("Invalid number");
+            maxGapFill = hours;
+        }
+        catch (const exception& e) {
+            cout << "Invalid input. Gap filling unchanged." << endl;
+        }
+    }
+
+    // gap bitmap is recorded while the column is parsed
+    WeatherTable table = dataset.current()->table({ country }, startDate, endDate);
+    const GapBitmap& validity = table.validity[0];
+    vector<pair<long long, long long>> gaps = validity.gaps();
+    long long longest = 0, longestStart = 0;
+    size_t fillable = 0;
+    for (const pair<long long, long long>& gap : gaps) {
+        if (gap.second > longest) {
+            longest = gap.second;
+            longestStart = gap.first;
+        }
+        if (gap.second <= maxGapFill) fillable++;
+    }
+
+    cout << "\nData quality for " << country << ":" << endl;
+    cout << "Hours in timeline: " << validity.numHours << endl;
+    cout << "Missing or invalid hours: " << validity.countMissing() << " in " << gaps.size() << " gaps" << endl;
+    if (longest > 0) {
+        cout << "Longest gap: " << longest << " hours from " << WeatherTable::dateOf(DataQuality::stampOf(longestStart)) << endl;
+    }
+    cout << "Gaps short enough to interpolate: " << fillable << " (up to " << maxGapFill << " hours)" << endl << endl;
+
+    updateCollection();
+    collection.displayCoverage();
 }
\ No newline at end of file
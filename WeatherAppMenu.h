@@ -1,18 +1,22 @@
 #pragma once
 
 #include "CandlesticksCollection.h"
+#include "Climatology.h"
+#include "DatasetSnapshot.h"
 #include <string>
 using namespace std;
 
 class WeatherAppMenu {
 public:
     WeatherAppMenu(const string& filename);
-    const string& filename;
+    const string filename;
     string country;
     string year;
     void init();
 
 private:
+    DatasetStore dataset; // current snapshot, reloaded in the background when the file changes
+    long long collectionVersion = 0; // snapshot version the collection was computed from
     CandlesticksCollection collection;
 
     Timeframe currentTimeframe;
@@ -22,9 +26,18 @@ private:
     void displayCandlesticks();
     void plotCandlesticks();
     void plotStackedBars();
+    void plotHeatmap();
+    void interactiveChart();
     void setTimeframe();
     void setCountry();
     void predictTemperatures();
+    void toggleExtendedStats();
+    void showAnomalies();
+    void showCorrelations();
+    void showDataQuality();
+    void setIndicators();
+    void showProfiles();
+    void exportData();
 
     // helper functions
     void processUserOption(int option);
@@ -32,6 +45,8 @@ private:
     void printMenu();
     void setTimeframe(Timeframe tf);
     void setYear();
+    void updateCollection();
+    void refreshIfReloaded();
 
     //for filtering
     float minTemp = numeric_limits<float>::lowest();
@@ -40,4 +55,11 @@ private:
     string endDate = "";
     void setFilters();
     void resetFilters();
+
+    bool extendedStats = false;
+    int maxGapFill = 0; // hours of missing readings interpolated, 0 = off
+    Climatology climatology; // anomaly baseline, loaded on first use
+    long long climatologyVersion = 0; // snapshot version the baseline was built from
+    int indicatorWindow = 0; // periods, 0 = off
+    double bandWidth = 2.0;
 };
\ No newline at end of file
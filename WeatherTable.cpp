@@ -0,0 +1,254 @@
+#include "WeatherTable.h"
+#include "DatasetManifest.h"
+#include "CsvReader.h"
+#include "Regions.h"
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+// digits of a fixed-width field, -1 if any character is not a digit
+static int parseDigits(const char* text, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (text[i] < '0' || text[i] > '9') return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+// YYYY-MM-DD[THH] fields packed as YYYYMMDDHH, -1 if a field is not digits or month/day/hour are out of their
+// widest range; bounds are packed with this alone, so a bound like 1990-02-31 still orders after every Feb day
+static int packFields(const char* timestamp, size_t length) {
+    if (length < 10) return -1;
+    int year = parseDigits(timestamp, 4);
+    int month = parseDigits(timestamp + 5, 2);
+    int day = parseDigits(timestamp + 8, 2);
+    int hour = length >= 13 ? parseDigits(timestamp + 11, 2) : 0;
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23) return -1;
+    return ((year * 100 + month) * 100 + day) * 100 + hour;
+}
+
+// accepts YYYY-MM-DD, optionally followed by THH..., as found in the utc_timestamp column
+// the date must exist (no month 13, hour 99 or Feb 31), so every consumer of a packed stamp can
+// index month, day-of-year and hour tables without checking again
+int WeatherTable::packStamp(const char* timestamp, size_t length) {
+    int stamp = packFields(timestamp, length);
+    if (stamp < 0 || dayOf(stamp) > DataQuality::daysInMonth(yearOf(stamp), monthOf(stamp))) return -1;
+    return stamp;
+}
+
+string WeatherTable::dateOf(int stamp) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", yearOf(stamp), monthOf(stamp), dayOf(stamp));
+    return buffer;
+}
+
+int WeatherTable::boundStamp(const string& date, bool upper) {
+    if (date.empty()) return upper ? numeric_limits<int>::max() : numeric_limits<int>::min();
+    string full = date;
+    if (full.size() == 4) full += upper ? "-12" : "-01";
+    if (full.size() == 7) full += upper ? "-31" : "-01";
+    int stamp = packFields(full.c_str(), full.size());
+    if (stamp < 0) {
+        cerr << "Warning: Invalid date bound '" << date << "' ignored." << endl;
+        return upper ? numeric_limits<int>::max() : numeric_limits<int>::min();
+    }
+    return upper ? stamp + 23 : stamp;
+}
+
+int WeatherTable::columnIndex(const string& name) const {
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        if (columnNames[i] == name) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+const vector<float>& WeatherTable::column(const string& name) const {
+    int index = columnIndex(name);
+    if (index == -1) {
+        throw invalid_argument("Country not found");
+    }
+    return columns[index];
+}
+
+WeatherTable WeatherTable::load(const string& path,
+    const vector<string>& selected,
+    const string& startDate,
+    const string& endDate
+) {
+    RegionSet regions = RegionSet::load(RegionSet::configPath(path));
+    if (regions.empty()) {
+        return loadColumns(path, selected, startDate, endDate);
+    }
+    return withRegions(regions, DatasetManifest::datasetColumns(path), selected, [&](const vector<string>& columns) {
+        return loadColumns(path, columns, startDate, endDate);
+    });
+}
+
+WeatherTable WeatherTable::withRegions(const RegionSet& regions,
+    const vector<string>& known,
+    const vector<string>& selected,
+    const function<WeatherTable(const vector<string>&)>& read
+) {
+    if (regions.empty()) {
+        return read(selected);
+    }
+
+    if (selected.empty()) {
+        WeatherTable table = read({});
+        for (const Region& region : regions.regions) {
+            if (table.columnIndex(region.name) != -1 || !RegionSet::materialize(table, region)) {
+                cerr << "Warning: Region '" << region.name << "' skipped, it clashes with a column or uses a missing one." << endl;
+            }
+        }
+        return table;
+    }
+
+    // selected regions are replaced by their member columns for reading
+    auto regionOf = [&](const string& name) -> const Region* {
+        return find(known.begin(), known.end(), name) == known.end() ? regions.find(name) : nullptr;
+    };
+    vector<string> columns;
+    for (const string& name : selected) {
+        const Region* region = regionOf(name);
+        vector<string> needed;
+        if (region) {
+            for (const pair<string, float>& member : region->members) needed.push_back(member.first);
+        }
+        else {
+            needed.push_back(name);
+        }
+        for (const string& column : needed) {
+            if (find(columns.begin(), columns.end(), column) == columns.end()) columns.push_back(column);
+        }
+    }
+    WeatherTable loaded = read(columns);
+    for (const string& name : selected) {
+        const Region* region = regionOf(name);
+        if (region && loaded.columnIndex(name) == -1) RegionSet::materialize(loaded, *region);
+    }
+
+    // keep only the selected columns, in the order they were asked for
+    WeatherTable table;
+    table.stamps = move(loaded.stamps);
+    for (const string& name : selected) {
+        int index = loaded.columnIndex(name);
+        table.columnNames.push_back(name);
+        table.columns.push_back(loaded.columns[index]);
+        table.validity.push_back(loaded.validity[index]);
+    }
+    return table;
+}
+
+WeatherTable WeatherTable::loadColumns(const string& path,
+    const vector<string>& selected,
+    const string& startDate,
+    const string& endDate
+) {
+    int firstStamp = boundStamp(startDate, false);
+    int lastStamp = boundStamp(endDate, true);
+
+    // partitions are pruned on the year only, rows are then filtered on the full timestamp
+    vector<string> files = DatasetManifest::resolveFiles(path, "", Timeframe::Yearly, "0",
+        startDate.substr(0, 4), endDate.substr(0, 4));
+
+    WeatherTable table;
+    table.columnNames = selected;
+    bool allColumns = selected.empty();
+    vector<bool> found(selected.size(), false);
+
+    for (const string& filePath : files) {
+        ifstream file(filePath);
+        if (!file.is_open()) {
+            cerr << "Error: Could not open the file '" << filePath << "'." << endl;
+            throw runtime_error("Could not open the file");
+        }
+        string line;
+        if (!getline(file, line)) continue;
+
+        vector<string> headers = CSVReader::tokenise(line, ',');
+        if (allColumns && table.columns.empty()) {
+            table.columnNames.assign(headers.begin() + min<size_t>(1, headers.size()), headers.end());
+        }
+        if (table.columns.empty()) {
+            table.columns.resize(table.columnNames.size());
+            table.validity.resize(table.columnNames.size());
+        }
+
+        // csv field -> table column, columns a partition lacks are filled with NaN
+        vector<int> slotOf(headers.size(), -1);
+        for (size_t i = 1; i < headers.size(); i++) {
+            int slot = table.columnIndex(headers[i]);
+            if (slot != -1) {
+                slotOf[i] = slot;
+                if (!allColumns) found[slot] = true;
+            }
+        }
+
+        while (getline(file, line)) {
+            if (line.empty()) continue;
+            // rows with fewer fields than the header are skipped, like the streaming reader does
+            size_t fields = 1 + count(line.begin(), line.end(), ',');
+            if (line.back() == ',') fields--;
+            if (fields < headers.size()) continue;
+
+            const char* field = line.c_str();
+            const char* comma = strchr(field, ',');
+            size_t stampLength = comma ? static_cast<size_t>(comma - field) : line.size();
+            int stamp = packStamp(field, stampLength);
+            if (stamp < 0 || stamp < firstStamp || stamp > lastStamp) continue;
+
+            size_t row = table.stamps.size();
+            long long hour = DataQuality::hourOf(stamp);
+            if (table.stamps.empty()) {
+                for (GapBitmap& bitmap : table.validity) {
+                    bitmap.firstHour = hour;
+                }
+            }
+            table.stamps.push_back(stamp);
+            for (size_t c = 0; c < table.columns.size(); c++) {
+                table.columns[c].push_back(missing());
+            }
+
+            size_t index = 1;
+            while (comma && index < slotOf.size()) {
+                field = comma + 1;
+                comma = strchr(field, ',');
+                int slot = slotOf[index++];
+                if (slot == -1) continue;
+                char* end;
+                float value = strtof(field, &end);
+                if (end != field && isfinite(value)) { // nan or inf in the file is a missing reading
+                    table.columns[slot][row] = value;
+                    table.validity[slot].mark(hour);
+                }
+            }
+        }
+    }
+
+    for (size_t c = 0; c < found.size(); c++) {
+        if (!found[c] && !files.empty()) {
+            cerr << "Error: Country '" << table.columnNames[c] << "' not found in the header." << endl;
+            throw invalid_argument("Country not found");
+        }
+    }
+
+    if (table.columns.empty()) {
+        table.columns.resize(table.columnNames.size());
+        table.validity.resize(table.columnNames.size());
+    }
+    // every column shares the table timeline, up to the last row
+    if (!table.stamps.empty()) {
+        long long lastHour = DataQuality::hourOf(table.stamps.back());
+        for (GapBitmap& bitmap : table.validity) {
+            bitmap.extendTo(lastHour);
+        }
+    }
+    return table;
+}
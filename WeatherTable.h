@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <limits>
+#include <cmath>
+#include <functional>
+#include "DataQuality.h"
+using namespace std;
+
+class RegionSet;
+
+// whole dataset (or a projection of it) held in memory column by column
+// rows keep the file order; missing or unparseable readings are stored as NaN
+class WeatherTable {
+public:
+    // load selected columns (all temperature columns when empty) from a csv file or partitioned directory
+    // regions defined next to the dataset (see RegionSet) can be selected like columns, and are all added when loading every column
+    // startDate/endDate are inclusive YYYY-MM-DD bounds, empty for no bound
+    static WeatherTable load(const string& path,
+        const vector<string>& columns = {},
+        const string& startDate = "",
+        const string& endDate = "");
+
+    vector<int> stamps; // packed YYYYMMDDHH per row
+    vector<string> columnNames;
+    vector<vector<float>> columns;
+    vector<GapBitmap> validity; // per column, recorded while parsing
+
+    size_t numRows() const { return stamps.size(); }
+    int columnIndex(const string& name) const; // -1 if not loaded
+    const vector<float>& column(const string& name) const; // throws invalid_argument if not loaded
+
+    // packed timestamp helpers
+    static int packStamp(const char* timestamp, size_t length); // -1 if malformed or not an existing date and hour
+    static int yearOf(int stamp) { return stamp / 1000000; }
+    static int monthOf(int stamp) { return stamp / 10000 % 100; }
+    static int dayOf(int stamp) { return stamp / 100 % 100; }
+    static int hourOf(int stamp) { return stamp % 100; }
+    static string dateOf(int stamp); // YYYY-MM-DD
+    // inclusive stamp bound for a (possibly partial) YYYY, YYYY-MM or YYYY-MM-DD date, open when empty
+    static int boundStamp(const string& date, bool upper);
+
+    static bool isMissing(float value) { return std::isnan(value); }
+    static float missing() { return numeric_limits<float>::quiet_NaN(); }
+
+    // columns read from the csv files only, no regions (all header columns when empty)
+    // throws invalid_argument if a selected column is not in the files
+    static WeatherTable loadColumns(const string& path,
+        const vector<string>& columns,
+        const string& startDate,
+        const string& endDate);
+    // selected columns and regions (every column and region when empty), with the csv columns taken from read:
+    // regions are replaced by their members for reading and then computed; a column wins over a region of the same name
+    static WeatherTable withRegions(const RegionSet& regions,
+        const vector<string>& datasetColumns,
+        const vector<string>& selected,
+        const function<WeatherTable(const vector<string>&)>& read);
+};
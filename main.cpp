@@ -5,17 +5,143 @@
 #include <sstream>
 #include <limits>
 #include <iomanip>
+#include <cctype>
+#include <algorithm>
 #include "Candlestick.h"
 #include "WeatherAppMenu.h"
 #include "CsvReader.h"
 #include "CandlesticksCollection.h"
+#include "DatasetManifest.h"
+#include "OutOfCoreAggregator.h"
+#include "Exporter.h"
+#include "EngineCheck.h"
 
 using namespace std;
 
 
-int main() {
-    string filename = "weather_data_EU_1980-2019_temp_only.csv";
-    WeatherAppMenu app{ filename };
-    app.init();
+// non-empty and digits only
+static bool isNumber(const string& text) {
+    return !text.empty() && all_of(text.begin(), text.end(), [](char c) { return isdigit(static_cast<unsigned char>(c)) != 0; });
+}
+
+int main(int argc, char* argv[]) {
+    // partitioned datasets: weather_app --build-manifest <directory> <partition files...>
+    if (argc >= 4 && string(argv[1]) == "--build-manifest") {
+        vector<string> files(argv + 3, argv + argc);
+        DatasetManifest manifest = DatasetManifest::build(argv[2], files);
+        cout << "Manifest written for " << manifest.partitions.size() << " partitions." << endl;
+        return 0;
+    }
+
+    // bounded-memory batch run: weather_app --batch <dataset> <yearly | monthly YYYY> <memory cap MB> <countries...>
+    if (argc >= 3 && string(argv[1]) == "--batch") {
+        vector<string> args(argv + 3, argv + argc);
+        Timeframe timeframe = Timeframe::Yearly;
+        string year = "0";
+        size_t next = 1;
+        if (!args.empty() && args[0] == "monthly") {
+            timeframe = Timeframe::Monthly;
+            year = args.size() > 1 ? args[1] : "";
+            next = 2;
+        }
+        else if (args.empty() || args[0] != "yearly") {
+            cerr << "Error: Period must be 'yearly' or 'monthly YYYY'." << endl;
+            return 1;
+        }
+        if (timeframe == Timeframe::Monthly && (year.size() != 4 || !isNumber(year))) {
+            cerr << "Error: Invalid year '" << year << "', expected YYYY." << endl;
+            return 1;
+        }
+        if (args.size() < next + 2) {
+            cerr << "Error: Usage: --batch <dataset> <yearly | monthly YYYY> <memory cap MB> <countries...>" << endl;
+            return 1;
+        }
+        vector<string> countries(args.begin() + next + 1, args.end());
+
+        if (!isNumber(args[next]) || args[next].size() > 9) {
+            cerr << "Error: Invalid memory cap '" << args[next] << "', expected a number of MB." << endl;
+            return 1;
+        }
+
+        OutOfCoreOptions options;
+        size_t peakMemory = 0, spillCount = 0;
+        map<string, vector<Candlestick>> candlesticks;
+        try {
+            options.memoryCap = static_cast<size_t>(stoul(args[next])) << 20;
+            OutOfCoreAggregator aggregator(options); // removes its spill files even when the run throws
+            candlesticks = aggregator.computeCandlesticks(argv[2], countries, timeframe, year);
+            peakMemory = aggregator.peakMemory();
+            spillCount = aggregator.spillCount();
+        }
+        catch (const exception& e) {
+            return 1; // the reason was already reported
+        }
+        cout << fixed;
+        cout.precision(3);
+        for (const string& country : countries) {
+            cout << CandlesticksCollection::timeframeToString(timeframe) << " candlesticks representation for " << country << " temperature:" << endl << endl;
+            cout << "Date\tOpen\tHigh\tLow\tClose" << endl << endl;
+            for (Candlestick& cs : candlesticks[country]) {
+                cout << cs;
+            }
+            cout << endl;
+        }
+        cerr << "Peak aggregate memory: " << (peakMemory >> 10) << " KB, spills: " << spillCount << endl;
+        return 0;
+    }
+
+    // export: weather_app --export <dataset> <csv|ndjson|binary> <output> <yearly|YYYY|raw>[,...] <countries...>
+    if (argc >= 7 && string(argv[1]) == "--export") {
+        ExportFormat format;
+        if (!Exporter::parseFormat(argv[3], format)) {
+            cerr << "Error: Unknown export format '" << argv[3] << "'." << endl;
+            return 1;
+        }
+        vector<string> periods = CSVReader::tokenise(argv[5], ',');
+        vector<string> countries(argv + 6, argv + argc);
+        try {
+            shared_ptr<const DatasetSnapshot> snapshot = DatasetSnapshot::load(argv[2]);
+            if (periods.size() == 1 && periods[0] == "raw") {
+                return Exporter::exportColumns(argv[4], format, snapshot->table(countries), countries) ? 0 : 1;
+            }
+            // every country in every period, from the one snapshot
+            vector<CandleSeries> series;
+            for (const string& country : countries) {
+                for (const string& period : periods) {
+                    Timeframe timeframe = period == "yearly" ? Timeframe::Yearly : Timeframe::Monthly;
+                    string year = timeframe == Timeframe::Monthly ? period : "0";
+                    string label = CandlesticksCollection::timeframeToString(timeframe) + (year != "0" ? " " + year : "");
+                    series.push_back({ country, label, snapshot->computeCandlesticks(country, timeframe, year,
+                        numeric_limits<float>::lowest(), numeric_limits<float>::max(), "", "", true) });
+                }
+            }
+            return Exporter::exportCandlesticks(argv[4], format, series) ? 0 : 1;
+        }
+        catch (const exception& e) {
+            return 1; // the reason was already reported
+        }
+    }
+
+    // engine equivalence and timing check: weather_app --check-engines <dataset> <baseline file> [countries...]
+    // the first two countries of the dataset are checked when none are given
+    if (argc >= 4 && string(argv[1]) == "--check-engines") {
+        vector<string> countries(argv + 4, argv + argc);
+        if (countries.empty()) {
+            vector<string> columns = DatasetManifest::datasetColumns(argv[2]);
+            countries.assign(columns.begin(), columns.begin() + min<size_t>(columns.size(), 2));
+        }
+        EngineCheck check;
+        return check.run(argv[2], countries, argv[3]) ? 0 : 1;
+    }
+
+    // dataset is either a single csv file or a directory of partitions with a manifest
+    string filename = argc >= 2 ? argv[1] : "weather_data_EU_1980-2019_temp_only.csv";
+    try {
+        WeatherAppMenu app{ filename };
+        app.init();
+    }
+    catch (const runtime_error& e) {
+        return 1; // the dataset could not be loaded, the reason was already reported
+    }
     return 0;
 }
\ No newline at end of file